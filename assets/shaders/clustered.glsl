@@ -0,0 +1,80 @@
+// Clustered forward lighting, shared by cluster_lights.comp and the fragment
+// shaders that use it. Layouts match src/renderer/lighting.h.
+#ifndef LIGHTING_SET
+#define LIGHTING_SET 1
+#endif
+// The binning pass writes the grid and index list; shading only reads them.
+#ifndef CLUSTER_ACCESS
+#define CLUSTER_ACCESS readonly
+#endif
+
+#define LIGHT_POINT 0
+#define LIGHT_SPOT 1
+
+struct Light {
+    vec3 position;      // view space
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;     // view space, spot lights only
+    float spot_outer_cos;
+    float spot_inner_cos;
+    uint type;
+    uint pad0;
+    uint pad1;
+};
+
+layout(set = LIGHTING_SET, binding = 0) uniform ClusterParams {
+    mat4 view;
+    vec4 proj;      // x scale, y scale, near, far
+    uvec4 grid;     // x, y, z, light count
+    vec4 screen;    // width, height, tile size, slices / log(far / near)
+} cluster;
+
+layout(std430, set = LIGHTING_SET, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+// (offset, count) into light_indices per cluster
+layout(std430, set = LIGHTING_SET, binding = 2) CLUSTER_ACCESS buffer ClusterGrid {
+    uvec2 cluster_lights[];
+};
+
+layout(std430, set = LIGHTING_SET, binding = 3) CLUSTER_ACCESS buffer LightIndices {
+    uint light_index_count;
+    uint light_indices[];
+};
+
+// Froxel of a fragment: screen tile, then an exponential slice of the
+// positive view depth.
+uint cluster_index(vec2 frag_coord, float view_depth) {
+    uvec2 tile = min(uvec2(frag_coord / cluster.screen.z), cluster.grid.xy - 1);
+    float slice = log(max(view_depth, cluster.proj.z) / cluster.proj.z) * cluster.screen.w;
+    uint z = min(uint(slice), cluster.grid.z - 1);
+    return tile.x + cluster.grid.x * (tile.y + cluster.grid.y * z);
+}
+
+// Smooth window to zero at the range, over inverse square falloff.
+float light_attenuation(Light light, float dist) {
+    float window = clamp(1.0 - pow(dist / light.range, 4.0), 0.0, 1.0);
+    return window * window / (dist * dist + 1.0);
+}
+
+// Diffuse lighting from every light binned into the fragment's cluster.
+// `view_pos` and `normal` are in view space.
+vec3 clustered_lighting(vec2 frag_coord, vec3 view_pos, vec3 normal, vec3 albedo) {
+    uvec2 range = cluster_lights[cluster_index(frag_coord, -view_pos.z)];
+    vec3 result = vec3(0.0);
+    for (uint i = 0; i < range.y; i++) {
+        Light light = lights[light_indices[range.x + i]];
+        vec3 to_light = light.position - view_pos;
+        float dist = length(to_light);
+        vec3 l = to_light / max(dist, 1e-4);
+
+        float attenuation = light_attenuation(light, dist);
+        if (light.type == LIGHT_SPOT)
+            attenuation *= smoothstep(light.spot_outer_cos, light.spot_inner_cos, dot(-l, light.direction));
+        result += albedo * light.color * light.intensity * attenuation * max(dot(normal, l), 0.0);
+    }
+    return result;
+}
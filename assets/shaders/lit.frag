@@ -0,0 +1,15 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered.glsl"
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragViewPos;
+layout(location = 2) in vec3 fragViewNormal;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 ambient = 0.03 * fragColor;
+    vec3 lit = clustered_lighting(gl_FragCoord.xy, fragViewPos, normalize(fragViewNormal), fragColor);
+    outColor = vec4(ambient + lit, 1.0);
+}
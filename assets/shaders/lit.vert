@@ -0,0 +1,31 @@
+#version 450
+
+// tri.vert's triangle with the view-space inputs lit.frag needs. It stands
+// one unit in front of the camera, facing it.
+// The depth pre-pass and the shading pass must agree on depth exactly.
+invariant gl_Position;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragViewPos;
+layout(location = 2) out vec3 fragViewNormal;
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+);
+
+vec3 colors[3] = vec3[](
+    vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0)
+);
+
+void main() {
+    vec2 position = positions[gl_VertexIndex];
+    gl_Position = vec4(position, 0.0, 1.0);
+    fragColor = colors[gl_VertexIndex];
+    // Clip space y points down, view space y up.
+    fragViewPos = vec3(position.x, -position.y, -1.0);
+    fragViewNormal = vec3(0.0, 0.0, 1.0);
+}
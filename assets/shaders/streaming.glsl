@@ -0,0 +1,47 @@
+// Streamed textures, shared by fragment shaders that sample them. Layouts
+// match src/renderer/texture_streaming.h. Declares the bindless texture
+// array (set 0, binding 0) unless the includer already has it.
+#extension GL_EXT_nonuniform_qualifier : require
+
+#ifndef STREAMING_SET
+#define STREAMING_SET 2
+#endif
+
+#ifndef BINDLESS_TEXTURES
+#define BINDLESS_TEXTURES
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+#endif
+
+struct StreamedTexture {
+    uint slot;          // bindless index of the current image
+    uint width;         // of the full-resolution level
+    uint height;
+    uint first_level;   // finest resident level
+};
+
+layout(std430, set = STREAMING_SET, binding = 0) readonly buffer StreamTable {
+    StreamedTexture streamed[];
+};
+
+// Finest level any pixel asked for this frame, 0xFFFFFFFF if unsampled.
+layout(std430, set = STREAMING_SET, binding = 1) buffer StreamFeedback {
+    uint stream_feedback[];
+};
+
+vec4 sample_streamed(uint id, vec2 uv) {
+    StreamedTexture t = streamed[id];
+
+    // Level against the full chain, not the resident image, so the
+    // feedback says how much detail is missing.
+    vec2 texel = uv * vec2(t.width, t.height);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+
+    // One pixel in each 8x8 block reports, which finds the level while
+    // keeping the atomics rare.
+    if ((uint(gl_FragCoord.x) & 7u) == 0u && (uint(gl_FragCoord.y) & 7u) == 0u)
+        atomicMin(stream_feedback[id], uint(max(lod, 0.0)));
+
+    return texture(textures[nonuniformEXT(t.slot)], uv);
+}
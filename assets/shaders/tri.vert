@@ -1,5 +1,8 @@
 #version 450
 
+// The depth pre-pass and the shading pass must agree on depth exactly.
+invariant gl_Position;
+
 layout(location = 0) out vec3 fragColor;
 
 vec2 positions[3] = vec2[](
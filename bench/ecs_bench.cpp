@@ -0,0 +1,74 @@
+// Iteration throughput of the archetype store against an array of fat
+// game objects. Build with `make ecs_bench`.
+#include "../src/ecs/world.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+struct Health { float value; };
+struct Name { char text[48]; };
+
+// AoS baseline: what a typical scene-node object drags through the cache
+// when only position and velocity are needed.
+struct GameObject {
+    Position position;
+    Velocity velocity;
+    float transform[16];
+    Health health;
+    Name name;
+};
+
+static const uint32_t ENTITY_COUNT = 1'000'000;
+static const uint32_t ITERATIONS = 50;
+static const float DT = 1.0f / 60.0f;
+
+template<typename F>
+static double measure(F&& f) {
+    f();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) f();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (double(ITERATIONS) * ENTITY_COUNT);
+}
+
+int main() {
+    JobSystem jobs;
+    jobs.init();
+
+    std::vector<GameObject> objects(ENTITY_COUNT);
+    World world;
+    for (uint32_t i = 0; i < ENTITY_COUNT; ++i) {
+        Position p{float(i), 0.0f, 0.0f};
+        Velocity v{1.0f, 2.0f, 3.0f};
+        objects[i].position = p;
+        objects[i].velocity = v;
+        world.create(p, v, Health{100.0f}, Name{});
+    }
+
+    double aos = measure([&]() {
+        for (auto& object : objects) {
+            object.position.x += object.velocity.x * DT;
+            object.position.y += object.velocity.y * DT;
+            object.position.z += object.velocity.z * DT;
+        }
+    });
+
+    auto integrate = [](Position& p, const Velocity& v) {
+        p.x += v.x * DT;
+        p.y += v.y * DT;
+        p.z += v.z * DT;
+    };
+    double ecs = measure([&]() { world.each<Position, Velocity>(integrate); });
+    double ecs_par = measure([&]() { world.par_each<Position, Velocity>(jobs, integrate); });
+
+    std::printf("entities:        %u\n", ENTITY_COUNT);
+    std::printf("threads:         %u\n", jobs.thread_count());
+    std::printf("aos:             %.3f ns/entity\n", aos);
+    std::printf("ecs:             %.3f ns/entity (%.2fx)\n", ecs, aos / ecs);
+    std::printf("ecs (parallel):  %.3f ns/entity (%.2fx)\n", ecs_par, aos / ecs_par);
+    return 0;
+}
@@ -0,0 +1,516 @@
+// Deterministic synthetic scenes rendered through the headless path, with
+// results written as JSON so runs can be diffed across commits. Build and
+// run with `make bench`, or `./rune_bench [--frames N] [--out file.json]`.
+#include "../src/const.h"
+#include "../src/renderer/renderer.h"
+#include "../src/renderer/host_allocator.h"
+#include "../src/utils/file.h"
+#include "../src/utils/frame_stats.h"
+#include "../src/utils/texture_asset.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const uint32_t WARMUP_FRAMES = 10;
+static const uint32_t DEFAULT_FRAMES = 300;
+
+// Sized so a CPU implementation (lavapipe) still finishes in seconds.
+static const uint32_t SMALL_DRAWS = 20'000;
+static const uint32_t INSTANCES = 200'000;
+static const VkDeviceSize UPLOAD_BYTES = 16ull << 20;
+static const uint32_t PIPELINES_PER_FRAME = 16;
+// Feature scenes: the draw list they all record, and their own load.
+static const uint32_t LIST_DRAWS = 2'000;
+static const uint32_t LIGHTS = 4'096;
+static const uint32_t STREAMED_TEXTURES = 8;
+static const uint32_t STREAMED_SIZE = 512;
+
+struct SceneBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr;
+};
+
+static SceneBuffer create_buffer(Renderer& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    SceneBuffer result;
+
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(renderer.device, &info, host_allocator(), &result.buffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to create bench buffer!");
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(renderer.device, result.buffer, &requirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = renderer.find_memory_type(requirements.memoryTypeBits, properties);
+    if (vkAllocateMemory(renderer.device, &allocInfo, host_allocator(), &result.memory) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate bench buffer memory!");
+    vkBindBufferMemory(renderer.device, result.buffer, result.memory, 0);
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        vkMapMemory(renderer.device, result.memory, 0, size, 0, &result.mapped);
+    return result;
+}
+
+static void destroy_buffer(Renderer& renderer, SceneBuffer& buffer) {
+    if (buffer.mapped) vkUnmapMemory(renderer.device, buffer.memory);
+    vkDestroyBuffer(renderer.device, buffer.buffer, host_allocator());
+    vkFreeMemory(renderer.device, buffer.memory, host_allocator());
+    buffer = {};
+}
+
+// ---------------- scenes ----------------
+struct Scene {
+    uint64_t draws = 0;
+    uint64_t instances = 0;
+    uint64_t pipelines = 0;
+    VkDeviceSize device_bytes = 0;
+    VkDeviceSize uploaded_bytes = 0;
+
+    virtual ~Scene() = default;
+    virtual const char* name() const = 0;
+    // Sets renderer options; called before init.
+    virtual void configure(Renderer& renderer) {}
+    virtual void setup(Renderer& renderer) {}
+    // Called once per frame before Renderer::draw().
+    virtual void frame(Renderer& renderer) {}
+    virtual void teardown(Renderer& renderer) {}
+};
+
+// Per-draw CPU and driver overhead: thousands of one-triangle draws.
+struct SmallDrawsScene : Scene {
+    const char* name() const override { return "small_draws"; }
+
+    void setup(Renderer& renderer) override {
+        renderer.in_pass = [this](VkCommandBuffer command_buffer) {
+            for (uint32_t i = 0; i < SMALL_DRAWS; i++)
+                vkCmdDraw(command_buffer, 3, 1, 0, 0);
+            draws += SMALL_DRAWS;
+            instances += SMALL_DRAWS;
+        };
+    }
+};
+
+// Vertex throughput from a single draw with a very large instance count.
+struct InstancedScene : Scene {
+    const char* name() const override { return "instanced"; }
+
+    void setup(Renderer& renderer) override {
+        renderer.in_pass = [this](VkCommandBuffer command_buffer) {
+            vkCmdDraw(command_buffer, 3, INSTANCES, 0, 0);
+            draws += 1;
+            instances += INSTANCES;
+        };
+    }
+};
+
+// Host writes and a staging copy of UPLOAD_BYTES every frame. Each frame in
+// flight has its own staging buffer, so the CPU never overwrites data the
+// GPU is still reading.
+struct UploadChurnScene : Scene {
+    std::vector<SceneBuffer> staging;
+    SceneBuffer target;
+    uint32_t frame_index = 0;
+
+    const char* name() const override { return "upload_churn"; }
+
+    void setup(Renderer& renderer) override {
+        for (uint32_t i = 0; i < rune::MAX_FRAMES_IN_FLIGHT; i++) {
+            staging.push_back(create_buffer(renderer, UPLOAD_BYTES, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        }
+        target = create_buffer(renderer, UPLOAD_BYTES, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        device_bytes = UPLOAD_BYTES * (rune::MAX_FRAMES_IN_FLIGHT + 1);
+
+        // Runs inside draw(), after the frame slot's wait.
+        renderer.pre_pass = [this, &renderer](VkCommandBuffer command_buffer) {
+            SceneBuffer& source = staging[renderer.current_frame];
+            uint32_t* words = static_cast<uint32_t*>(source.mapped);
+            for (VkDeviceSize i = 0; i < UPLOAD_BYTES / 4; i++)
+                words[i] = uint32_t(i) * 2654435761u ^ frame_index;
+            frame_index++;
+
+            // Previous frame's copy into the same target must finish first.
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = target.buffer;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            VkBufferCopy region{0, 0, UPLOAD_BYTES};
+            vkCmdCopyBuffer(command_buffer, source.buffer, target.buffer, 1, &region);
+            uploaded_bytes += UPLOAD_BYTES;
+        };
+        renderer.in_pass = [this](VkCommandBuffer command_buffer) {
+            vkCmdDraw(command_buffer, 3, 1, 0, 0);
+            draws += 1;
+            instances += 1;
+        };
+    }
+
+    void teardown(Renderer& renderer) override {
+        for (auto& buffer : staging) destroy_buffer(renderer, buffer);
+        destroy_buffer(renderer, target);
+    }
+};
+
+// Pipeline creation cost: several full graphics pipelines built and
+// destroyed every frame. Drivers with an internal pipeline cache report
+// their warm-cache cost here.
+struct PipelineStormScene : Scene {
+    VkShaderModule vert = VK_NULL_HANDLE;
+    VkShaderModule frag = VK_NULL_HANDLE;
+
+    const char* name() const override { return "pipeline_storm"; }
+
+    void setup(Renderer& renderer) override {
+        vert = renderer.create_shader_module(read_file("./assets/shaders/tri.vert.spv"));
+        frag = renderer.create_shader_module(read_file("./assets/shaders/tri.frag.spv"));
+        renderer.in_pass = [this](VkCommandBuffer command_buffer) {
+            vkCmdDraw(command_buffer, 3, 1, 0, 0);
+            draws += 1;
+            instances += 1;
+        };
+    }
+
+    void frame(Renderer& renderer) override {
+        for (uint32_t i = 0; i < PIPELINES_PER_FRAME; i++) {
+            VkPipeline pipeline = renderer.build_graphics_pipeline(vert, frag);
+            vkDestroyPipeline(renderer.device, pipeline, host_allocator());
+        }
+        pipelines += PIPELINES_PER_FRAME;
+    }
+
+    void teardown(Renderer& renderer) override {
+        vkDestroyShaderModule(renderer.device, vert, host_allocator());
+        vkDestroyShaderModule(renderer.device, frag, host_allocator());
+    }
+};
+
+// LIST_DRAWS one-triangle records with the default pipeline, so the
+// feature scenes go through record_draw_list() and the depth pre-pass.
+static void queue_triangles(Renderer& renderer, Scene& scene, BindlessPush indices = {}) {
+    DrawRecord draw;
+    draw.count = 3;
+    draw.indices = indices;
+    renderer.draw_list.assign(LIST_DRAWS, draw);
+    scene.draws += LIST_DRAWS;
+    scene.instances += LIST_DRAWS;
+}
+
+// Depth-only pipelines lay down depth, shading tests EQUAL.
+struct DepthPrepassScene : Scene {
+    const char* name() const override { return "depth_prepass"; }
+    void configure(Renderer& renderer) override { renderer.depth_prepass = true; }
+    void frame(Renderer& renderer) override { queue_triangles(renderer, *this); }
+};
+
+// 4x color and depth with the in-pass resolve.
+struct MsaaScene : Scene {
+    const char* name() const override { return "msaa_4x"; }
+    void configure(Renderer& renderer) override { renderer.msaa_samples = VK_SAMPLE_COUNT_4_BIT; }
+    void frame(Renderer& renderer) override { queue_triangles(renderer, *this); }
+};
+
+// Light binning over LIGHTS point and spot lights scattered through the
+// view frustum, then the lit shading pass.
+struct ClusteredLightingScene : Scene {
+    const char* name() const override { return "clustered_lighting"; }
+    void configure(Renderer& renderer) override { renderer.clustered_lighting = true; }
+
+    void setup(Renderer& renderer) override {
+        const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        renderer.lighting.set_view(identity, 1.0f, 1.0f, 0.1f, 100.0f);
+
+        uint32_t seed = 1;
+        auto random = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return float(seed >> 8) / float(1u << 24);
+        };
+        renderer.lighting.lights.resize(LIGHTS);
+        for (uint32_t i = 0; i < LIGHTS; i++) {
+            GpuLight& light = renderer.lighting.lights[i];
+            float depth = 0.5f + 60.0f * random();
+            light.position[0] = (random() * 2.0f - 1.0f) * depth;
+            light.position[1] = (random() * 2.0f - 1.0f) * depth;
+            light.position[2] = -depth;
+            light.range = 0.5f + 4.0f * random();
+            for (float& c : light.color) c = random();
+            if (i % 4 == 0) {
+                light.type = LIGHT_SPOT;
+                light.spot_outer_cos = 0.8f;
+                light.spot_inner_cos = 0.9f;
+            }
+        }
+        device_bytes = sizeof(GpuLight) * LIGHTS;
+    }
+
+    void frame(Renderer& renderer) override { queue_triangles(renderer, *this); }
+};
+
+// Streamed textures baked to temporary .rtex files, sampled through
+// texture ids in the draw records, plus one ordinary bindless texture.
+struct TextureStreamingScene : Scene {
+    std::vector<std::string> paths;
+    std::vector<uint32_t> ids;
+    ImageHandle texture;
+
+    const char* name() const override { return "texture_streaming"; }
+    void configure(Renderer& renderer) override { renderer.texture_streaming = true; }
+
+    void setup(Renderer& renderer) override {
+        for (uint32_t t = 0; t < STREAMED_TEXTURES; t++) {
+            TextureAsset asset;
+            asset.width = asset.height = STREAMED_SIZE;
+            for (uint32_t size = STREAMED_SIZE; size >= 1; size /= 2) {
+                std::vector<uint8_t> level(size * size * 4);
+                for (size_t i = 0; i < level.size(); i++) level[i] = uint8_t(i * 31 + t * 97 + size);
+                uploaded_bytes += level.size();
+                asset.levels.push_back(std::move(level));
+            }
+            std::string path = (std::filesystem::temp_directory_path() /
+                                ("rune_bench_" + std::to_string(t) + ".rtex")).string();
+            write_texture_asset(path, asset);
+            paths.push_back(path);
+            if (renderer.streamer.enabled()) ids.push_back(renderer.stream_texture(path));
+        }
+        texture = renderer.load_texture(paths[0]);
+        device_bytes = uploaded_bytes;
+    }
+
+    void frame(Renderer& renderer) override {
+        BindlessPush indices;
+        if (!ids.empty()) indices.texture = ids[draws / LIST_DRAWS % ids.size()];
+        queue_triangles(renderer, *this, indices);
+    }
+
+    void teardown(Renderer& renderer) override {
+        renderer.destroy(texture);
+        for (const std::string& path : paths) std::filesystem::remove(path);
+    }
+};
+
+// A small frame graph run every frame: two clear-and-copy chains whose
+// first targets alias, and a pass that is culled.
+struct RenderGraphScene : Scene {
+    const char* name() const override { return "render_graph"; }
+
+    void setup(Renderer& renderer) override {
+        RenderGraph& graph = renderer.graph;
+        VkExtent2D extent = renderer.swapchain_extent;
+        const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        RGResource first = graph.create_image("first", format, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+        RGResource second = graph.create_image("second", format, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+        RGResource result = graph.create_image("result", format, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+        RGResource unused = graph.create_image("unused", format, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+        graph.export_image(result, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        auto clear = [&graph](RGResource image, float value) {
+            return [&graph, image, value](VkCommandBuffer command_buffer) {
+                VkClearColorValue color = {{value, value, value, 1.0f}};
+                VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                vkCmdClearColorImage(command_buffer, graph.image(image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                     &color, 1, &range);
+            };
+        };
+        auto copy = [&graph, extent](RGResource from, RGResource to) {
+            return [&graph, extent, from, to](VkCommandBuffer command_buffer) {
+                VkImageCopy region{};
+                region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                region.extent = {extent.width, extent.height, 1};
+                vkCmdCopyImage(command_buffer, graph.image(from), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               graph.image(to), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            };
+        };
+
+        RGPass pass = graph.add_pass("clear first", clear(first, 0.25f));
+        graph.use(pass, first, RGUsage::TRANSFER_DST);
+        pass = graph.add_pass("clear second", clear(second, 0.75f));
+        graph.use(pass, second, RGUsage::TRANSFER_DST);
+        pass = graph.add_pass("copy first", copy(first, result));
+        graph.use(pass, first, RGUsage::TRANSFER_SRC);
+        graph.use(pass, result, RGUsage::TRANSFER_DST);
+        pass = graph.add_pass("copy second", copy(second, result));
+        graph.use(pass, second, RGUsage::TRANSFER_SRC);
+        graph.use(pass, result, RGUsage::TRANSFER_DST);
+        pass = graph.add_pass("clear unused", clear(unused, 1.0f));
+        graph.use(pass, unused, RGUsage::TRANSFER_DST);
+    }
+
+    void frame(Renderer& renderer) override {
+        queue_triangles(renderer, *this);
+        device_bytes = renderer.graph.stats().transient_bytes;
+    }
+};
+
+// ---------------- runner ----------------
+struct SceneResult {
+    std::string name;
+    double startup_ms = 0.0;
+    FrameStats stats;
+    double gpu_ms = 0.0;
+    double draws_per_frame = 0.0;
+    double instances_per_frame = 0.0;
+    double pipelines_per_frame = 0.0;
+    double upload_mb_per_frame = 0.0;
+    VkDeviceSize device_bytes = 0;
+    uint64_t peak_rss_kb = 0;
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// High-water mark of resident memory for the whole process (Linux).
+static uint64_t peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::stoull(line.substr(6));
+    }
+    return 0;
+}
+
+static SceneResult run_scene(Scene& scene, uint32_t frames, std::string& device_name) {
+    SceneResult result;
+    result.name = scene.name();
+
+    auto start = std::chrono::steady_clock::now();
+    Renderer renderer;
+    scene.configure(renderer);
+    renderer.init_headless();
+    scene.setup(renderer);
+    result.startup_ms = elapsed_ms(start);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(renderer.physical_device, &properties);
+    device_name = properties.deviceName;
+
+    for (uint32_t i = 0; i < WARMUP_FRAMES; i++) {
+        scene.frame(renderer);
+        renderer.draw();
+    }
+    scene.draws = scene.instances = scene.pipelines = scene.uploaded_bytes = 0;
+
+    std::vector<double> frame_ms;
+    frame_ms.reserve(frames);
+    auto last = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frames; i++) {
+        scene.frame(renderer);
+        renderer.draw();
+        auto now = std::chrono::steady_clock::now();
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+        last = now;
+    }
+    renderer.device_wait_idle();
+
+    result.stats = compute_frame_stats(std::move(frame_ms));
+    result.gpu_ms = renderer.gpu_profiler.enabled() ? renderer.gpu_profiler.frame_ms() : 0.0;
+    result.draws_per_frame = double(scene.draws) / frames;
+    result.instances_per_frame = double(scene.instances) / frames;
+    result.pipelines_per_frame = double(scene.pipelines) / frames;
+    result.upload_mb_per_frame = double(scene.uploaded_bytes) / frames / (1024.0 * 1024.0);
+    result.device_bytes = scene.device_bytes;
+    result.peak_rss_kb = peak_rss_kb();
+
+    scene.teardown(renderer);
+    renderer.pre_pass = nullptr;
+    renderer.in_pass = nullptr;
+    renderer.deinit();
+    return result;
+}
+
+static std::string to_json(const std::string& device_name, uint32_t frames, const std::vector<SceneResult>& results) {
+    std::ostringstream out;
+    out << "{\n  \"device\": \"" << device_name << "\",\n"
+        << "  \"frames\": " << frames << ",\n"
+        << "  \"warmup_frames\": " << WARMUP_FRAMES << ",\n"
+        << "  \"scenes\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const SceneResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\n"
+            << "      \"name\": \"" << r.name << "\",\n"
+            << "      \"startup_ms\": " << r.startup_ms << ",\n"
+            << "      \"frame_ms\": {\"mean\": " << r.stats.mean_ms << ", \"p50\": " << r.stats.p50_ms
+            << ", \"p99\": " << r.stats.p99_ms << ", \"min\": " << r.stats.min_ms << ", \"max\": " << r.stats.max_ms << "},\n"
+            << "      \"gpu_frame_ms\": " << r.gpu_ms << ",\n"
+            << "      \"draws_per_frame\": " << r.draws_per_frame << ",\n"
+            << "      \"instances_per_frame\": " << r.instances_per_frame << ",\n"
+            << "      \"pipelines_per_frame\": " << r.pipelines_per_frame << ",\n"
+            << "      \"upload_mb_per_frame\": " << r.upload_mb_per_frame << ",\n"
+            << "      \"scene_device_bytes\": " << r.device_bytes << ",\n"
+            << "      \"peak_rss_kb\": " << r.peak_rss_kb << "\n"
+            << "    }";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = DEFAULT_FRAMES;
+    std::string out_path;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: rune_bench [--frames N] [--out file.json]\n");
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Scene>> scenes;
+    scenes.push_back(std::make_unique<SmallDrawsScene>());
+    scenes.push_back(std::make_unique<InstancedScene>());
+    scenes.push_back(std::make_unique<UploadChurnScene>());
+    scenes.push_back(std::make_unique<PipelineStormScene>());
+    scenes.push_back(std::make_unique<DepthPrepassScene>());
+    scenes.push_back(std::make_unique<MsaaScene>());
+    scenes.push_back(std::make_unique<ClusteredLightingScene>());
+    scenes.push_back(std::make_unique<TextureStreamingScene>());
+    scenes.push_back(std::make_unique<RenderGraphScene>());
+
+    std::string device_name;
+    std::vector<SceneResult> results;
+    for (auto& scene : scenes) {
+        results.push_back(run_scene(*scene, frames, device_name));
+        const SceneResult& r = results.back();
+        std::fprintf(stderr, "%-16s startup %8.2f ms | mean %7.3f ms | p50 %7.3f ms | p99 %7.3f ms\n",
+                     r.name.c_str(), r.startup_ms, r.stats.mean_ms, r.stats.p50_ms, r.stats.p99_ms);
+    }
+
+    std::string json = to_json(device_name, frames, results);
+    if (out_path.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else {
+        std::ofstream file(out_path);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "failed to open %s\n", out_path.c_str());
+            return 1;
+        }
+        file << json;
+    }
+    return 0;
+}
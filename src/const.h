@@ -5,4 +5,6 @@
 namespace rune {
     const uint32_t WIDTH = 800;
     const uint32_t HEIGHT = 600;
+    const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    const uint32_t HEADLESS_FRAMES = 1000;
 }
\ No newline at end of file
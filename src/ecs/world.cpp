@@ -0,0 +1,147 @@
+#include "world.h"
+
+#include <mutex>
+#include <stdexcept>
+
+static std::mutex registry_mutex;
+static ComponentInfo registry[rune::MAX_COMPONENTS];
+static uint32_t registry_count = 0;
+
+ComponentId register_component(uint32_t size, uint32_t align) {
+    std::lock_guard lock(registry_mutex);
+    if (registry_count >= rune::MAX_COMPONENTS)
+        throw std::runtime_error("too many component types!");
+
+    registry[registry_count] = {size, align};
+    return registry_count++;
+}
+
+const ComponentInfo& component_info(ComponentId id) {
+    return registry[id];
+}
+
+static uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// ---------------- archetype ----------------
+Archetype::Archetype(ComponentMask mask) : mask(mask) {
+    uint32_t row_size = sizeof(Entity);
+    uint32_t padding = 0;
+    for (ComponentId id = 0; id < rune::MAX_COMPONENTS; ++id) {
+        if (!has(id)) continue;
+        const ComponentInfo& info = component_info(id);
+        column_of[id] = static_cast<uint32_t>(components.size());
+        components.push_back(id);
+        sizes.push_back(info.size);
+        row_size += info.size;
+        padding += info.align;
+    }
+
+    capacity = (rune::CHUNK_SIZE - padding) / row_size;
+    if (capacity == 0)
+        throw std::runtime_error("archetype does not fit in a chunk!");
+
+    uint32_t offset = capacity * sizeof(Entity);
+    for (ComponentId id : components) {
+        const ComponentInfo& info = component_info(id);
+        offset = align_up(offset, info.align);
+        offsets.push_back(offset);
+        offset += capacity * info.size;
+    }
+}
+
+// ---------------- world ----------------
+Archetype* World::get_archetype(ComponentMask mask) {
+    auto it = m_archetype_lookup.find(mask);
+    if (it != m_archetype_lookup.end()) return it->second;
+
+    m_archetypes.push_back(std::make_unique<Archetype>(mask));
+    Archetype* archetype = m_archetypes.back().get();
+    m_archetype_lookup.emplace(mask, archetype);
+    return archetype;
+}
+
+Entity World::allocate_entity() {
+    if (!m_free.empty()) {
+        uint32_t index = m_free.back();
+        m_free.pop_back();
+        return {index, m_records[index].generation};
+    }
+
+    m_records.emplace_back();
+    return {static_cast<uint32_t>(m_records.size() - 1), 0};
+}
+
+bool World::alive(Entity entity) const {
+    return entity.index < m_records.size() &&
+           m_records[entity.index].archetype != nullptr &&
+           m_records[entity.index].generation == entity.generation;
+}
+
+void World::destroy(Entity entity) {
+    if (!alive(entity)) return;
+
+    EntityRecord& record = m_records[entity.index];
+    remove_row(record.archetype, record.chunk, record.row);
+    record.archetype = nullptr;
+    record.generation++;
+    m_free.push_back(entity.index);
+}
+
+void World::push_row(Archetype* archetype, Entity entity, EntityRecord& record) {
+    if (archetype->chunks.empty() || archetype->chunks.back()->count == archetype->capacity)
+        archetype->chunks.push_back(std::make_unique<Chunk>());
+
+    Chunk& chunk = *archetype->chunks.back();
+    archetype->entities(chunk)[chunk.count] = entity;
+
+    record.archetype = archetype;
+    record.chunk = static_cast<uint32_t>(archetype->chunks.size() - 1);
+    record.row = chunk.count++;
+}
+
+// Fills the hole with the archetype's very last row so every chunk except
+// the last one stays full.
+void World::remove_row(Archetype* archetype, uint32_t chunk_index, uint32_t row) {
+    Chunk& chunk = *archetype->chunks[chunk_index];
+    Chunk& last = *archetype->chunks.back();
+    uint32_t last_row = last.count - 1;
+
+    if (&chunk != &last || row != last_row) {
+        Entity moved = archetype->entities(last)[last_row];
+        archetype->entities(chunk)[row] = moved;
+        for (size_t i = 0; i < archetype->components.size(); ++i) {
+            std::byte* dst = chunk.data + archetype->offsets[i];
+            std::byte* src = last.data + archetype->offsets[i];
+            uint32_t size = archetype->sizes[i];
+            std::memcpy(dst + row * size, src + last_row * size, size);
+        }
+        m_records[moved.index].chunk = chunk_index;
+        m_records[moved.index].row = row;
+    }
+
+    if (--last.count == 0)
+        archetype->chunks.pop_back();
+}
+
+void World::move_entity(Entity entity, Archetype* destination) {
+    EntityRecord& record = m_records[entity.index];
+    Archetype* source = record.archetype;
+    uint32_t src_chunk = record.chunk;
+    uint32_t src_row = record.row;
+
+    push_row(destination, entity, record);
+    Chunk& from = *source->chunks[src_chunk];
+    Chunk& to = *destination->chunks[record.chunk];
+    for (size_t i = 0; i < source->components.size(); ++i) {
+        ComponentId id = source->components[i];
+        if (!destination->has(id)) continue;
+        uint32_t size = source->sizes[i];
+        std::memcpy(destination->column(to, id) + record.row * size, source->column(from, id) + src_row * size, size);
+    }
+
+    // remove_row may relocate another entity of the source archetype, but
+    // never this one: its record already points at the destination.
+    remove_row(source, src_chunk, src_row);
+}
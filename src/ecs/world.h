@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../jobs/job_system.h"
+
+namespace rune {
+    // Every chunk is a fixed 16KB block: small enough to stay cache resident
+    // while a system walks it, big enough to amortize the per-chunk lookups.
+    const uint32_t CHUNK_SIZE = 16 * 1024;
+    const uint32_t MAX_COMPONENTS = 64;
+}
+
+using ComponentId = uint32_t;
+using ComponentMask = uint64_t;
+
+// Generational handle: `index` is the slot in the entity table, `generation`
+// is bumped every time the slot is recycled so stale handles are detected.
+struct Entity {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity&) const = default;
+};
+
+struct ComponentInfo {
+    uint32_t size;
+    uint32_t align;
+};
+
+ComponentId register_component(uint32_t size, uint32_t align);
+const ComponentInfo& component_info(ComponentId id);
+
+// Components are stored as raw bytes and moved with memcpy, so they have to
+// be plain data.
+template<typename T>
+ComponentId component_id() {
+    static_assert(std::is_trivially_copyable_v<T>, "components must be trivially copyable");
+    static const ComponentId id = register_component(sizeof(T), alignof(T));
+    return id;
+}
+
+template<typename T>
+ComponentMask component_bit() {
+    return ComponentMask(1) << component_id<T>();
+}
+
+struct Chunk {
+    alignas(64) std::byte data[rune::CHUNK_SIZE];
+    uint32_t count = 0;
+};
+
+// All entities with exactly the same set of components. Each chunk is laid
+// out as [entities][column 0][column 1]..., one dense column per component.
+struct Archetype {
+    ComponentMask mask = 0;
+    uint32_t capacity = 0;
+    std::vector<ComponentId> components;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> sizes;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    uint32_t column_of[rune::MAX_COMPONENTS];
+
+    Archetype(ComponentMask mask);
+
+    bool has(ComponentId id) const { return mask & (ComponentMask(1) << id); }
+    std::byte* column(Chunk& chunk, ComponentId id) const { return chunk.data + offsets[column_of[id]]; }
+    Entity* entities(Chunk& chunk) const { return reinterpret_cast<Entity*>(chunk.data); }
+
+    template<typename T>
+    T* column(Chunk& chunk) const { return reinterpret_cast<T*>(column(chunk, component_id<T>())); }
+};
+
+// What a query callback sees for one chunk: `count` entities and the dense
+// arrays for the requested components.
+struct ChunkView {
+    const Archetype* archetype;
+    Chunk* chunk;
+    uint32_t count;
+
+    Entity* entities() const { return archetype->entities(*chunk); }
+
+    template<typename T>
+    T* column() const { return archetype->column<T>(*chunk); }
+};
+
+struct World {
+    World() = default;
+
+    // Not copyable or movable
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
+    World(World &&) = delete;
+    World &operator=(World &&) = delete;
+
+    template<typename... Ts>
+    Entity create(const Ts&... components) {
+        Archetype* archetype = get_archetype((ComponentMask(0) | ... | component_bit<Ts>()));
+        Entity entity = allocate_entity();
+        EntityRecord& record = m_records[entity.index];
+        push_row(archetype, entity, record);
+        (write(record, components), ...);
+        return entity;
+    }
+
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    size_t size() const { return m_records.size() - m_free.size(); }
+
+    template<typename T>
+    bool has(Entity entity) const {
+        return alive(entity) && m_records[entity.index].archetype->has(component_id<T>());
+    }
+
+    // Returns nullptr if the entity is dead or lacks the component.
+    template<typename T>
+    T* get(Entity entity) {
+        if (!has<T>(entity)) return nullptr;
+        const EntityRecord& record = m_records[entity.index];
+        return record.archetype->column<T>(*record.archetype->chunks[record.chunk]) + record.row;
+    }
+
+    template<typename T>
+    void add(Entity entity, const T& component) {
+        if (!alive(entity)) return;
+        EntityRecord& record = m_records[entity.index];
+        if (!record.archetype->has(component_id<T>()))
+            move_entity(entity, get_archetype(record.archetype->mask | component_bit<T>()));
+        write(record, component);
+    }
+
+    template<typename T>
+    void remove(Entity entity) {
+        if (!has<T>(entity)) return;
+        EntityRecord& record = m_records[entity.index];
+        move_entity(entity, get_archetype(record.archetype->mask & ~component_bit<T>()));
+    }
+
+    // --- queries ---
+    // Only archetypes containing every Ts are visited, and only their columns
+    // are touched.
+    template<typename... Ts, typename F>
+    void each_chunk(F&& f) {
+        const ComponentMask mask = (ComponentMask(0) | ... | component_bit<Ts>());
+        for (auto& archetype : m_archetypes) {
+            if ((archetype->mask & mask) != mask) continue;
+            for (auto& chunk : archetype->chunks)
+                f(ChunkView{archetype.get(), chunk.get(), chunk->count});
+        }
+    }
+
+    template<typename... Ts, typename F>
+    void each(F&& f) {
+        each_chunk<Ts...>([&](const ChunkView& view) {
+            auto run = [&](Ts*... columns) {
+                for (uint32_t i = 0; i < view.count; ++i) f(columns[i]...);
+            };
+            run(view.column<Ts>()...);
+        });
+    }
+
+    template<typename... Ts>
+    std::vector<ChunkView> collect_chunks() {
+        std::vector<ChunkView> views;
+        each_chunk<Ts...>([&](const ChunkView& view) { views.push_back(view); });
+        return views;
+    }
+
+    // Chunks never share memory, so each one can go to a different worker.
+    // Structural changes (create/destroy/add/remove) are not allowed while
+    // this runs.
+    template<typename... Ts, typename F>
+    void par_each_chunk(JobSystem& jobs, F&& f) {
+        std::vector<ChunkView> views = collect_chunks<Ts...>();
+        jobs.parallel_for("ecs::par_each_chunk", static_cast<uint32_t>(views.size()), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) f(views[i]);
+        });
+    }
+
+    template<typename... Ts, typename F>
+    void par_each(JobSystem& jobs, F&& f) {
+        par_each_chunk<Ts...>(jobs, [&](const ChunkView& view) {
+            auto run = [&](Ts*... columns) {
+                for (uint32_t i = 0; i < view.count; ++i) f(columns[i]...);
+            };
+            run(view.column<Ts>()...);
+        });
+    }
+
+    private:
+    struct EntityRecord {
+        Archetype* archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::unordered_map<ComponentMask, Archetype*> m_archetype_lookup;
+    std::vector<EntityRecord> m_records;
+    std::vector<uint32_t> m_free;
+
+    Archetype* get_archetype(ComponentMask mask);
+    Entity allocate_entity();
+    void push_row(Archetype* archetype, Entity entity, EntityRecord& record);
+    void remove_row(Archetype* archetype, uint32_t chunk, uint32_t row);
+    void move_entity(Entity entity, Archetype* destination);
+
+    template<typename T>
+    void write(const EntityRecord& record, const T& component) {
+        T* column = record.archetype->column<T>(*record.archetype->chunks[record.chunk]);
+        std::memcpy(column + record.row, &component, sizeof(T));
+    }
+};
@@ -1,20 +1,45 @@
 #include "engine.h"
+#include "profiler/profiler.h"
+#include "renderer/host_allocator.h"
+#include "utils/frame_stats.h"
+#include "const.h"
 
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
-void Engine::init() {
+void Engine::init(const EngineOptions& opts) {
+    options = opts;
     window = new Window();
     renderer = new Renderer();
-    
-    window->init_window();
-    renderer->init_renderer(window);
-    loop();
+    world = new World();
+    jobs = new JobSystem();
+
+    PROFILE_INIT();
+    jobs->init();
+#ifdef RUNE_PROFILE
+    jobs->set_timing_hook(profiler_job_hook);
+#endif
+    renderer->jobs = jobs;
+    if (options.headless) {
+        renderer->init_headless();
+        loop_headless();
+    } else {
+        window->init_window();
+        renderer->init_renderer(window);
+        loop();
+    }
     deinit();
 }
 
 void Engine::loop() {
+    auto stats_start = std::chrono::steady_clock::now();
+    uint32_t stats_frames = 0;
+
     while (!glfwWindowShouldClose(window->inner)) {
+        PROFILE_ZONE("frame");
         glfwSetKeyCallback(window->inner, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -29,14 +54,93 @@ void Engine::loop() {
                 std::cout << "D pressed\n";
         });
 
-        glfwPollEvents();
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        bool capture_key = glfwGetKey(window->inner, GLFW_KEY_F12) == GLFW_PRESS;
+        if (capture_key && !capture_key_down)
+            renderer->capture("capture_" + std::to_string(capture_count++) + ".png");
+        capture_key_down = capture_key;
+
+        jobs->pump_main_thread();
+        renderer->draw();
+
+        stats_frames++;
+        auto now = std::chrono::steady_clock::now();
+        double elapsed_ms = std::chrono::duration<double, std::milli>(now - stats_start).count();
+        if (elapsed_ms >= 500.0) {
+            update_stats(elapsed_ms / stats_frames);
+            stats_start = now;
+            stats_frames = 0;
+        }
+    }
+    renderer->device_wait_idle();
+}
+
+// Renders a fixed number of frames without a window and prints frame time
+// statistics. Each sample is the wall time between consecutive draw()
+// returns, so with frames in flight it tracks throughput, not latency.
+void Engine::loop_headless() {
+    uint32_t frames = options.frames ? options.frames : rune::HEADLESS_FRAMES;
+    std::vector<double> frame_ms;
+    frame_ms.reserve(frames);
+
+    HostAllocationStats hostBefore = host_allocation_stats();
+    auto last = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frames; i++) {
+        PROFILE_ZONE("frame");
+        jobs->pump_main_thread();
+        if (i + 1 == frames && !options.dump_path.empty())
+            renderer->capture(options.dump_path);
         renderer->draw();
-        // std::cout << "drawed a frame\n";
+
+        auto now = std::chrono::steady_clock::now();
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+        last = now;
     }
     renderer->device_wait_idle();
+
+    FrameStats stats = compute_frame_stats(std::move(frame_ms));
+    std::cout << std::fixed << std::setprecision(3)
+              << "headless: " << stats.frames << " frames"
+              << " | mean " << stats.mean_ms << " ms"
+              << " | p50 " << stats.p50_ms << " ms"
+              << " | p99 " << stats.p99_ms << " ms";
+    if (renderer->gpu_profiler.enabled())
+        std::cout << " | gpu " << renderer->gpu_profiler.frame_ms() << " ms";
+    MemoryBudget::Stats memory = renderer->memory_budget.stats();
+    std::cout << " | vram " << (memory.device_local_usage >> 20) << "/" << (memory.device_local_budget >> 20) << " MiB";
+    HostAllocationStats hostAfter = host_allocation_stats();
+    uint64_t hostAllocations = 0;
+    for (uint32_t i = 0; i < HOST_ALLOCATION_SCOPE_COUNT; i++)
+        hostAllocations += hostAfter.scopes[i].allocations - hostBefore.scopes[i].allocations;
+    std::cout << " | driver allocs/frame " << double(hostAllocations) / frames;
+    std::cout << "\n";
+}
+
+// Frame stats go in the window title until there is a real overlay.
+void Engine::update_stats(double cpu_frame_ms) {
+    std::ostringstream title;
+    title << std::fixed << std::setprecision(2) << "Rune | frame " << cpu_frame_ms << " ms";
+
+    const GpuProfiler& gpu = renderer->gpu_profiler;
+    if (gpu.enabled()) {
+        title << " | gpu " << gpu.frame_ms() << " ms";
+        for (const auto& pass : gpu.timings())
+            title << " | " << pass.name << " " << pass.ms << " ms";
+    }
+    MemoryBudget::Stats memory = renderer->memory_budget.stats();
+    title << " | vram " << (memory.device_local_usage >> 20) << "/" << (memory.device_local_budget >> 20) << " MiB";
+    glfwSetWindowTitle(window->inner, title.str().c_str());
 }
 
 void Engine::deinit() {
     renderer->deinit();
-    window->deinit();
+    if (!options.headless) window->deinit();
+    jobs->deinit();
+    delete jobs;
+    PROFILE_WRITE_TRACE("rune_trace.json");
+    delete world;
 }
\ No newline at end of file
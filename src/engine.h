@@ -2,12 +2,29 @@
 
 #include "window.h"
 #include "renderer/renderer.h"
+#include "ecs/world.h"
+#include "jobs/job_system.h"
+
+#include <string>
+
+struct EngineOptions {
+    bool headless = false;
+    uint32_t frames = 0;    // headless frame count, 0 = rune::HEADLESS_FRAMES
+    std::string dump_path;  // headless: capture the final frame (.png or .ppm)
+};
 
 struct Engine {
     Window* window = nullptr;
     Renderer* renderer = nullptr;
+    World* world = nullptr;
+    JobSystem* jobs = nullptr;
+    EngineOptions options;
+    uint32_t capture_count = 0;
+    bool capture_key_down = false;
 
-    void init();
+    void init(const EngineOptions& opts = {});
     void loop();
+    void loop_headless();
+    void update_stats(double cpu_frame_ms);
     void deinit();
 };
\ No newline at end of file
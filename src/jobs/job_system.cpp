@@ -0,0 +1,235 @@
+#include "job_system.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+static thread_local uint32_t t_worker = UINT32_MAX;
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------- work-stealing queue ----------------
+bool WorkStealingQueue::push(Job* job) {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY) return false;
+
+    m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingQueue::pop() {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // last item: race the thieves for it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingQueue::steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+
+    Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+// ---------------- core ----------------
+void JobSystem::init(uint32_t thread_count) {
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    m_running = true;
+    for (uint32_t i = 0; i < thread_count; ++i)
+        m_queues.push_back(std::make_unique<WorkStealingQueue>());
+
+    t_worker = 0;
+    for (uint32_t i = 1; i < thread_count; ++i)
+        m_workers.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+void JobSystem::deinit() {
+    if (!m_running) return;
+
+    m_running = false;
+    m_sleep_cv.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    // Nothing is left to run them; drop whatever was still queued.
+    for (auto& queue : m_queues)
+        while (Job* job = queue->pop()) delete job;
+    for (Job* job : m_shared_jobs) delete job;
+    for (Job* job : m_main_jobs) delete job;
+    m_shared_jobs.clear();
+    m_main_jobs.clear();
+    m_queues.clear();
+    t_worker = UINT32_MAX;
+}
+
+uint32_t JobSystem::worker_index() {
+    return t_worker;
+}
+
+// ---------------- scheduling ----------------
+void JobSystem::run(const char* name, std::function<void()> fn, JobCounter* counter, JobCounter* dependency) {
+    schedule(new Job{name, std::move(fn), counter, false}, dependency);
+}
+
+void JobSystem::run_on_main(const char* name, std::function<void()> fn, JobCounter* counter, JobCounter* dependency) {
+    schedule(new Job{name, std::move(fn), counter, true}, dependency);
+}
+
+void JobSystem::parallel_for(const char* name, uint32_t count, uint32_t batch, std::function<void(uint32_t, uint32_t)> fn, JobCounter* counter, JobCounter* dependency) {
+    batch = std::max(1u, batch);
+    auto shared = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(fn));
+    for (uint32_t begin = 0; begin < count; begin += batch) {
+        uint32_t end = std::min(count, begin + batch);
+        run(name, [shared, begin, end]() { (*shared)(begin, end); }, counter, dependency);
+    }
+}
+
+void JobSystem::parallel_for(const char* name, uint32_t count, uint32_t batch, std::function<void(uint32_t, uint32_t)> fn) {
+    JobCounter counter;
+    parallel_for(name, count, batch, std::move(fn), &counter);
+    wait(counter);
+}
+
+void JobSystem::schedule(Job* job, JobCounter* dependency) {
+    if (job->counter)
+        job->counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency) {
+        std::lock_guard lock(dependency->m_mutex);
+        if (dependency->pending.load(std::memory_order_acquire) != 0) {
+            dependency->m_continuations.push_back(job);
+            return;
+        }
+    }
+    enqueue(job);
+}
+
+void JobSystem::enqueue(Job* job) {
+    if (job->main_thread) {
+        std::lock_guard lock(m_main_mutex);
+        m_main_jobs.push_back(job);
+        return;
+    }
+
+    if (t_worker < m_queues.size()) {
+        if (!m_queues[t_worker]->push(job)) {
+            // queue full: cheaper to run it now than to grow under contention
+            execute(job);
+            return;
+        }
+    } else {
+        std::lock_guard lock(m_shared_mutex);
+        m_shared_jobs.push_back(job);
+    }
+    m_sleep_cv.notify_one();
+}
+
+// ---------------- execution ----------------
+Job* JobSystem::find_job(uint32_t worker) {
+    if (worker < m_queues.size()) {
+        if (Job* job = m_queues[worker]->pop()) return job;
+    }
+
+    {
+        std::lock_guard lock(m_shared_mutex);
+        if (!m_shared_jobs.empty()) {
+            Job* job = m_shared_jobs.front();
+            m_shared_jobs.pop_front();
+            return job;
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(m_queues.size());
+    for (uint32_t i = 1; i <= count; ++i) {
+        uint32_t victim = (worker + i) % count;
+        if (victim == worker) continue;
+        if (Job* job = m_queues[victim]->steal()) return job;
+    }
+    return nullptr;
+}
+
+Job* JobSystem::pop_main_job() {
+    std::lock_guard lock(m_main_mutex);
+    if (m_main_jobs.empty()) return nullptr;
+    Job* job = m_main_jobs.front();
+    m_main_jobs.pop_front();
+    return job;
+}
+
+void JobSystem::execute(Job* job) {
+    JobTimingHook hook = m_timing_hook.load(std::memory_order_relaxed);
+    uint64_t start = hook ? now_ns() : 0;
+    job->fn();
+    if (hook) hook(job->name, t_worker, start, now_ns());
+
+    if (JobCounter* counter = job->counter) {
+        // The counter may be gone as soon as the lock is released.
+        std::vector<Job*> ready;
+        {
+            std::lock_guard lock(counter->m_mutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter->m_continuations);
+        }
+        for (Job* next : ready) enqueue(next);
+    }
+    delete job;
+}
+
+void JobSystem::worker_loop(uint32_t worker) {
+    t_worker = worker;
+    PROFILE_THREAD("worker " + std::to_string(worker));
+    uint32_t idle = 0;
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (Job* job = find_job(worker)) {
+            execute(job);
+            idle = 0;
+        } else if (++idle < 64) {
+            std::this_thread::yield();
+        } else {
+            std::unique_lock lock(m_sleep_mutex);
+            m_sleep_cv.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (!counter.done()) {
+        Job* job = t_worker == 0 ? pop_main_job() : nullptr;
+        if (!job) job = find_job(t_worker);
+
+        if (job) execute(job);
+        else std::this_thread::yield();
+    }
+}
+
+void JobSystem::pump_main_thread() {
+    while (Job* job = pop_main_job())
+        execute(job);
+}
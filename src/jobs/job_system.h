@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+// Tracks a group of in-flight jobs. Jobs scheduled with a counter bump it
+// and decrement it when they finish; other jobs can be made to depend on it
+// and only become runnable once it drops to zero.
+//
+// Decrements happen under the counter's mutex, and done() takes it
+// too, so once a waiter sees zero no job touches the counter again and it
+// can live on the waiter's stack.
+struct JobCounter {
+    std::atomic<uint32_t> pending{0};
+
+    bool done() const {
+        std::lock_guard lock(m_mutex);
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+    private:
+    friend struct JobSystem;
+    mutable std::mutex m_mutex;
+    std::vector<Job*> m_continuations;
+};
+
+struct Job {
+    const char* name = nullptr;
+    std::function<void()> fn;
+    JobCounter* counter = nullptr;
+    bool main_thread = false;
+};
+
+// Called after every job with its wall-clock span in steady_clock nanoseconds.
+using JobTimingHook = void (*)(const char* name, uint32_t worker, uint64_t start_ns, uint64_t end_ns);
+
+// Chase-Lev deque: the owning worker pushes and pops at the bottom, thieves
+// take from the top.
+struct WorkStealingQueue {
+    static const int64_t CAPACITY = 4096;
+
+    bool push(Job* job);
+    Job* pop();
+    Job* steal();
+
+    private:
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    std::atomic<Job*> m_jobs[CAPACITY];
+};
+
+// Fixed pool of workers. The thread calling init() becomes worker 0 and is
+// the only one that runs main-thread jobs (GLFW and presentation must stay
+// there).
+struct JobSystem {
+    JobSystem() = default;
+    ~JobSystem() { deinit(); }
+
+    // Not copyable or movable
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+    JobSystem(JobSystem &&) = delete;
+    JobSystem &operator=(JobSystem &&) = delete;
+
+    // 0 picks one thread per core, including the calling thread.
+    void init(uint32_t thread_count = 0);
+    void deinit();
+
+    void run(const char* name, std::function<void()> fn, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+    void run_on_main(const char* name, std::function<void()> fn, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Splits [0, count) into batches of `batch` items, each handed to
+    // fn(begin, end) as its own job.
+    void parallel_for(const char* name, uint32_t count, uint32_t batch, std::function<void(uint32_t, uint32_t)> fn, JobCounter* counter, JobCounter* dependency = nullptr);
+    void parallel_for(const char* name, uint32_t count, uint32_t batch, std::function<void(uint32_t, uint32_t)> fn);
+
+    // Runs other jobs until the counter reaches zero instead of blocking.
+    void wait(JobCounter& counter);
+    // Drains queued main-thread jobs; call once per frame from the main loop.
+    void pump_main_thread();
+
+    uint32_t thread_count() const { return static_cast<uint32_t>(m_queues.size()); }
+    // Index of the calling thread in the pool, or UINT32_MAX for outsiders.
+    static uint32_t worker_index();
+    void set_timing_hook(JobTimingHook hook) { m_timing_hook.store(hook); }
+
+    private:
+    std::vector<std::unique_ptr<WorkStealingQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running{false};
+    std::atomic<JobTimingHook> m_timing_hook{nullptr};
+
+    // Jobs submitted from threads outside the pool, and main-thread jobs.
+    std::mutex m_shared_mutex;
+    std::deque<Job*> m_shared_jobs;
+    std::mutex m_main_mutex;
+    std::deque<Job*> m_main_jobs;
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_cv;
+
+    void schedule(Job* job, JobCounter* dependency);
+    void enqueue(Job* job);
+    Job* find_job(uint32_t worker);
+    Job* pop_main_job();
+    void execute(Job* job);
+    void worker_loop(uint32_t worker);
+};
@@ -1,8 +1,26 @@
 #include "engine.h"
 
-int main() {
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    EngineOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--dump" && i + 1 < argc) {
+            options.dump_path = argv[++i];
+        } else {
+            std::cout << "usage: rune [--headless] [--frames N] [--dump frame.ppm]\n";
+            return 1;
+        }
+    }
+
     Engine engine;
-    engine.init();
+    engine.init(options);
 
     return 0;
 }
@@ -0,0 +1,161 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+thread_local ProfileThreadBuffer* t_profile_buffer = nullptr;
+
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+static ProfileThreadBuffer* gpu_buffer = nullptr;
+
+struct CounterSample {
+    const char* name;
+    uint64_t ticks;
+    double value;
+};
+
+// Counters are sampled a few times per frame at most; a locked ring is plenty.
+static const size_t COUNTER_CAPACITY = 1 << 16;
+static std::mutex counters_mutex;
+static std::vector<CounterSample> counters;
+static size_t counters_head = 0;
+
+// tick <-> steady_clock mapping, measured once in profiler_init()
+static uint64_t base_ticks = 0;
+static uint64_t base_ns = 0;
+static double ns_per_tick = 1.0;
+
+static uint64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler_init() {
+    base_ticks = profiler_now();
+    base_ns = steady_ns();
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Spin a few milliseconds to learn the TSC rate.
+    uint64_t end_ns = base_ns;
+    while (end_ns - base_ns < 5'000'000)
+        end_ns = steady_ns();
+    uint64_t end_ticks = profiler_now();
+    ns_per_tick = double(end_ns - base_ns) / double(end_ticks - base_ticks);
+#endif
+
+    profiler_set_thread_name("main");
+}
+
+ProfileThreadBuffer* profiler_register_thread() {
+    std::lock_guard lock(buffers_mutex);
+    buffers.push_back(std::make_unique<ProfileThreadBuffer>());
+    ProfileThreadBuffer* buffer = buffers.back().get();
+    buffer->thread_id = static_cast<uint32_t>(buffers.size() - 1);
+    buffer->thread_name = "thread " + std::to_string(buffer->thread_id);
+    return buffer;
+}
+
+void profiler_set_thread_name(const std::string& name) {
+    ProfileThreadBuffer& buffer = profiler_thread_buffer();
+    std::lock_guard lock(buffers_mutex);
+    buffer.thread_name = name;
+}
+
+void profiler_job_hook(const char* name, uint32_t worker, uint64_t start_ns, uint64_t end_ns) {
+    auto to_ticks = [](uint64_t ns) {
+        return base_ticks + static_cast<uint64_t>(double(int64_t(ns - base_ns)) / ns_per_tick);
+    };
+    profiler_thread_buffer().push(name ? name : "job", to_ticks(start_ns), to_ticks(end_ns));
+}
+
+void profiler_push_gpu_zone(const char* name, uint64_t anchor_ticks, double begin_ns, double end_ns) {
+    if (!gpu_buffer) {
+        gpu_buffer = profiler_register_thread();
+        std::lock_guard lock(buffers_mutex);
+        gpu_buffer->thread_name = "GPU";
+    }
+    gpu_buffer->push(name, anchor_ticks + static_cast<uint64_t>(begin_ns / ns_per_tick),
+                     anchor_ticks + static_cast<uint64_t>(end_ns / ns_per_tick));
+}
+
+void profiler_counter(const char* name, double value) {
+    uint64_t now = profiler_now();
+    std::lock_guard lock(counters_mutex);
+    if (counters.size() < COUNTER_CAPACITY) counters.push_back({name, now, value});
+    else counters[counters_head % COUNTER_CAPACITY] = {name, now, value};
+    counters_head++;
+}
+
+// ---------------- export ----------------
+static void write_escaped(std::ofstream& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+}
+
+bool profiler_write_chrome_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cout << "Failed to open trace file " << path << "\n";
+        return false;
+    }
+
+    auto to_us = [](uint64_t ticks) {
+        return double(int64_t(ticks - base_ticks)) * ns_per_tick / 1000.0;
+    };
+
+    std::lock_guard lock(buffers_mutex);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    std::vector<ProfileEvent> events;
+    for (auto& buffer : buffers) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->thread_id
+            << ",\"args\":{\"name\":\"";
+        write_escaped(out, buffer->thread_name.c_str());
+        out << "\"}}";
+        first = false;
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(buffer->tail, head > ProfileThreadBuffer::CAPACITY ? head - ProfileThreadBuffer::CAPACITY : 0);
+        events.clear();
+        for (uint64_t i = begin; i < head; ++i)
+            events.push_back(buffer->events[i & (ProfileThreadBuffer::CAPACITY - 1)]);
+
+        // Anything the owner overwrote (or is overwriting) while we were
+        // copying is torn; drop it.
+        uint64_t after = buffer->head.load(std::memory_order_acquire) + 1;
+        uint64_t valid = after > ProfileThreadBuffer::CAPACITY ? after - ProfileThreadBuffer::CAPACITY : 0;
+        size_t skip = valid > begin ? std::min<size_t>(valid - begin, events.size()) : 0;
+        buffer->tail = head;
+
+        for (size_t i = skip; i < events.size(); ++i) {
+            const ProfileEvent& event = events[i];
+            out << ",\n{\"name\":\"";
+            write_escaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread_id
+                << ",\"ts\":" << to_us(event.start)
+                << ",\"dur\":" << to_us(event.end) - to_us(event.start) << "}";
+        }
+    }
+
+    std::lock_guard counterLock(counters_mutex);
+    size_t begin = counters.size() < COUNTER_CAPACITY ? 0 : counters_head;
+    for (size_t i = 0; i < counters.size(); ++i) {
+        const CounterSample& sample = counters[(begin + i) % counters.size()];
+        out << (first ? "" : ",\n") << "{\"name\":\"";
+        first = false;
+        write_escaped(out, sample.name);
+        out << "\",\"ph\":\"C\",\"pid\":0,\"ts\":" << to_us(sample.ticks)
+            << ",\"args\":{\"value\":" << sample.value << "}}";
+    }
+    counters.clear();
+    counters_head = 0;
+    out << "\n]}\n";
+    return true;
+}
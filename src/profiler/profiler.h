@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// CPU instrumentation. Build with -DRUNE_PROFILE (make PROFILE=1, the
+// default) to enable it; otherwise every PROFILE_* macro expands to nothing.
+//
+//     void Renderer::draw() {
+//         PROFILE_ZONE("draw");
+//         ...
+//     }
+//
+// Zones are recorded into a per-thread ring and exported with
+// profiler_write_chrome_trace() for chrome://tracing or Perfetto.
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Single writer (the owning thread), single reader (the exporter). When the
+// ring wraps the oldest events are overwritten.
+struct ProfileThreadBuffer {
+    static const uint64_t CAPACITY = 1 << 16;
+
+    std::atomic<uint64_t> head{0};
+    uint64_t tail = 0;
+    uint32_t thread_id = 0;
+    std::string thread_name;
+    ProfileEvent events[CAPACITY];
+
+    void push(const char* name, uint64_t start, uint64_t end) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        events[h & (CAPACITY - 1)] = {name, start, end};
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+extern thread_local ProfileThreadBuffer* t_profile_buffer;
+
+void profiler_init();
+ProfileThreadBuffer* profiler_register_thread();
+void profiler_set_thread_name(const std::string& name);
+// Matches JobTimingHook, so the job system can report into the profiler.
+void profiler_job_hook(const char* name, uint32_t worker, uint64_t start_ns, uint64_t end_ns);
+// GPU work is timed in its own clock domain; spans are placed on a separate
+// "GPU" track relative to a CPU tick (usually when the frame was recorded).
+void profiler_push_gpu_zone(const char* name, uint64_t anchor_ticks, double begin_ns, double end_ns);
+// Sampled value, exported as a counter track; `name` must outlive the
+// profiler (a string literal).
+void profiler_counter(const char* name, double value);
+bool profiler_write_chrome_trace(const std::string& path);
+
+// Raw ticks: the TSC where available, converted to time only on export.
+inline uint64_t profiler_now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline ProfileThreadBuffer& profiler_thread_buffer() {
+    if (!t_profile_buffer) t_profile_buffer = profiler_register_thread();
+    return *t_profile_buffer;
+}
+
+struct ProfileZone {
+    const char* m_name;
+    uint64_t m_start;
+
+    ProfileZone(const char* name) : m_name(name), m_start(profiler_now()) {}
+    ~ProfileZone() { profiler_thread_buffer().push(m_name, m_start, profiler_now()); }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+};
+
+#ifdef RUNE_PROFILE
+    #define PROFILE_CONCAT_INNER(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+    #define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+    #define PROFILE_THREAD(name) profiler_set_thread_name(name)
+    #define PROFILE_INIT() profiler_init()
+    #define PROFILE_WRITE_TRACE(path) profiler_write_chrome_trace(path)
+    #define PROFILE_COUNTER(name, value) profiler_counter(name, value)
+#else
+    #define PROFILE_ZONE(name)
+    #define PROFILE_THREAD(name)
+    #define PROFILE_INIT()
+    #define PROFILE_WRITE_TRACE(path)
+    #define PROFILE_COUNTER(name, value)
+#endif
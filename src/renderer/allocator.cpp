@@ -0,0 +1,183 @@
+#include "allocator.h"
+#include "host_allocator.h"
+
+#include <stdexcept>
+
+void GpuAllocator::init(VkPhysicalDevice physical_device, VkDevice device, MemoryBudget* budget) {
+    m_device = device;
+    m_budget = budget;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+}
+
+void GpuAllocator::deinit() {
+    for (Block& block : m_blocks)
+        if (block.memory) release_block(block);
+    m_blocks.clear();
+    m_retired.clear();
+}
+
+GpuAllocation GpuAllocator::allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category) {
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+    GpuAllocation allocation = allocate(requirements, properties, true, category);
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+GpuAllocation GpuAllocator::allocate_image(VkImage image, VkMemoryPropertyFlags properties, MemoryCategory category) {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+    GpuAllocation allocation = allocate(requirements, properties, false, category);
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+uint32_t GpuAllocator::find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+        if ((type_bits & (1u << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+uint32_t GpuAllocator::create_block(VkDeviceSize size, uint32_t type, bool linear, bool dedicated) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = type;
+
+    // Gives the pressure hooks a chance to make room; the driver has the
+    // final say on whether the allocation succeeds.
+    if (m_budget) m_budget->reserve(type, size);
+
+    Block block;
+    if (vkAllocateMemory(m_device, &allocInfo, host_allocator(), &block.memory) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate memory block!");
+    if (m_budget) m_budget->track_heap(type, static_cast<int64_t>(size));
+    block.size = size;
+    block.type = type;
+    block.linear = linear;
+    block.dedicated = dedicated;
+    block.free.push_back({0, size});
+    if (m_memory_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        vkMapMemory(m_device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+
+    // Reuse the slot of a released dedicated block.
+    for (uint32_t i = 0; i < m_blocks.size(); i++) {
+        if (m_blocks[i].memory == VK_NULL_HANDLE) {
+            m_blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    m_blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+void GpuAllocator::release_block(Block& block) {
+    if (m_budget) m_budget->track_heap(block.type, -static_cast<int64_t>(block.size));
+    vkFreeMemory(m_device, block.memory, host_allocator());
+    block = Block{};
+}
+
+bool GpuAllocator::suballocate(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset) {
+    for (size_t i = 0; i < block.free.size(); i++) {
+        Range range = block.free[i];
+        VkDeviceSize aligned = (range.offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+        if (aligned + requirements.size > range.offset + range.size) continue;
+
+        // Split into the alignment gap before and the remainder after.
+        VkDeviceSize end = aligned + requirements.size;
+        block.free.erase(block.free.begin() + i);
+        if (end < range.offset + range.size)
+            block.free.insert(block.free.begin() + i, {end, range.offset + range.size - end});
+        if (aligned > range.offset)
+            block.free.insert(block.free.begin() + i, {range.offset, aligned - range.offset});
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear,
+                                     MemoryCategory category) {
+    uint32_t type = find_memory_type(requirements.memoryTypeBits, properties);
+    GpuAllocation allocation;
+    allocation.size = requirements.size;
+    allocation.category = category;
+
+    uint32_t blockIndex = UINT32_MAX;
+    VkDeviceSize offset = 0;
+    if (requirements.size > BLOCK_SIZE / 2) {
+        blockIndex = create_block(requirements.size, type, linear, true);
+        suballocate(m_blocks[blockIndex], requirements, offset);
+    } else {
+        for (uint32_t i = 0; i < m_blocks.size() && blockIndex == UINT32_MAX; i++) {
+            Block& block = m_blocks[i];
+            if (block.memory && !block.dedicated && block.type == type && block.linear == linear &&
+                suballocate(block, requirements, offset))
+                blockIndex = i;
+        }
+        if (blockIndex == UINT32_MAX) {
+            blockIndex = create_block(BLOCK_SIZE, type, linear, false);
+            suballocate(m_blocks[blockIndex], requirements, offset);
+        }
+    }
+
+    Block& block = m_blocks[blockIndex];
+    block.allocations++;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.block = blockIndex;
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+    if (m_budget) m_budget->track_category(category, static_cast<int64_t>(allocation.size));
+    return allocation;
+}
+
+void GpuAllocator::free(const GpuAllocation& allocation) {
+    if (!allocation) return;
+    Block& block = m_blocks[allocation.block];
+    block.allocations--;
+    if (m_budget) m_budget->track_category(allocation.category, -static_cast<int64_t>(allocation.size));
+
+    if (block.dedicated) {
+        release_block(block);
+        return;
+    }
+
+    // Insert in offset order and merge with the neighbours it touches.
+    Range range{allocation.offset, allocation.size};
+    auto it = block.free.begin();
+    while (it != block.free.end() && it->offset < range.offset) ++it;
+    it = block.free.insert(it, range);
+    if (it + 1 != block.free.end() && it->offset + it->size == (it + 1)->offset) {
+        it->size += (it + 1)->size;
+        block.free.erase(it + 1);
+    }
+    if (it != block.free.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+        (it - 1)->size += it->size;
+        block.free.erase(it);
+    }
+}
+
+void GpuAllocator::free(const GpuAllocation& allocation, uint64_t value) {
+    if (allocation) m_retired.emplace_back(value, allocation);
+}
+
+void GpuAllocator::collect(uint64_t completed) {
+    while (!m_retired.empty() && m_retired.front().first <= completed) {
+        free(m_retired.front().second);
+        m_retired.pop_front();
+    }
+}
+
+GpuAllocator::Stats GpuAllocator::stats() const {
+    Stats stats;
+    for (const Block& block : m_blocks) {
+        if (!block.memory) continue;
+        stats.blocks++;
+        stats.allocations += block.allocations;
+        stats.reserved_bytes += block.size;
+        stats.used_bytes += block.size;
+        for (const Range& range : block.free) stats.used_bytes -= range.size;
+    }
+    return stats;
+}
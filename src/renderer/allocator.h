@@ -0,0 +1,91 @@
+#pragma once
+
+#include "memory_budget.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+struct GpuAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistently mapped pointer for host-visible memory, else null.
+    void* mapped = nullptr;
+    uint32_t block = UINT32_MAX;
+    MemoryCategory category = MemoryCategory::OTHER;
+
+    explicit operator bool() const { return memory != VK_NULL_HANDLE; }
+};
+
+// Sub-allocates buffers and images from large device memory blocks instead
+// of one vkAllocateMemory each, which is slow and limited by
+// maxMemoryAllocationCount. First fit over each block's sorted free list;
+// freed ranges merge with their neighbours. Buffers and images never share
+// a block, so bufferImageGranularity never applies. Requests above half a
+// block get a dedicated block, released as soon as it is empty.
+//
+// Like BindlessHeap, frees can be deferred until the GPU has passed a
+// timeline value, so in-flight frames never see their memory reused.
+//
+// With a MemoryBudget, blocks count towards their heap and allocations
+// towards their category.
+struct GpuAllocator {
+    static const VkDeviceSize BLOCK_SIZE = 64ull << 20;
+
+    void init(VkPhysicalDevice physical_device, VkDevice device, MemoryBudget* budget = nullptr);
+    void deinit();
+
+    // Allocates and binds. Throws when no memory type fits or the device is
+    // out of memory.
+    GpuAllocation allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                                  MemoryCategory category = MemoryCategory::OTHER);
+    GpuAllocation allocate_image(VkImage image, VkMemoryPropertyFlags properties,
+                                 MemoryCategory category = MemoryCategory::OTHER);
+    void free(const GpuAllocation& allocation);
+    // `value` is the timeline value of the last submit that may use it.
+    void free(const GpuAllocation& allocation, uint64_t value);
+    // Frees allocations released at or below `completed`.
+    void collect(uint64_t completed);
+
+    struct Stats {
+        uint32_t blocks = 0;
+        uint32_t allocations = 0;
+        VkDeviceSize reserved_bytes = 0;
+        VkDeviceSize used_bytes = 0;
+    };
+    Stats stats() const;
+
+    private:
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t type = 0;
+        bool linear = false;
+        bool dedicated = false;
+        void* mapped = nullptr;
+        uint32_t allocations = 0;
+        // sorted by offset
+        std::vector<Range> free;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    MemoryBudget* m_budget = nullptr;
+    VkPhysicalDeviceMemoryProperties m_memory_properties{};
+    std::vector<Block> m_blocks;
+    std::deque<std::pair<uint64_t, GpuAllocation>> m_retired;
+
+    GpuAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear,
+                           MemoryCategory category);
+    uint32_t find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties) const;
+    uint32_t create_block(VkDeviceSize size, uint32_t type, bool linear, bool dedicated);
+    void release_block(Block& block);
+    bool suballocate(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset);
+};
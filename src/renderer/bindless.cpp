@@ -0,0 +1,202 @@
+#include "bindless.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // Left for the other sets in the same pipeline layouts (lighting: one
+    // uniform and three storage buffers, streaming: two storage buffers)
+    // and, in the per-stage resource limit, the color attachments.
+    const uint32_t RESERVED_STORAGE_BUFFERS = 8;
+    const uint32_t RESERVED_RESOURCES = 24;
+
+    uint32_t minus_reserved(uint32_t limit, uint32_t reserved) { return limit > reserved ? limit - reserved : 0; }
+}
+
+bool BindlessHeap::supported(const VkPhysicalDeviceVulkan12Features& features) {
+    return features.descriptorIndexing &&
+           features.runtimeDescriptorArray &&
+           features.descriptorBindingPartiallyBound &&
+           features.descriptorBindingSampledImageUpdateAfterBind &&
+           features.descriptorBindingStorageBufferUpdateAfterBind &&
+           features.descriptorBindingUpdateUnusedWhilePending &&
+           features.shaderSampledImageArrayNonUniformIndexing &&
+           features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+void BindlessHeap::enable(VkPhysicalDeviceVulkan12Features& features) {
+    features.descriptorIndexing = VK_TRUE;
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+}
+
+void BindlessHeap::init(VkPhysicalDevice physical_device, VkDevice device) {
+    VkPhysicalDeviceDescriptorIndexingProperties indexing{};
+    indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexing;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    m_textures = {};
+    m_buffers = {};
+    // Combined image samplers count as both sampled images and samplers.
+    // These limits cover every set of a pipeline layout, not just this one.
+    m_textures.capacity = std::min({MAX_TEXTURES, indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+                                    indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                    indexing.maxDescriptorSetUpdateAfterBindSamplers,
+                                    indexing.maxPerStageDescriptorUpdateAfterBindSamplers});
+    m_buffers.capacity = std::min({MAX_BUFFERS,
+                                   minus_reserved(indexing.maxDescriptorSetUpdateAfterBindStorageBuffers, RESERVED_STORAGE_BUFFERS),
+                                   minus_reserved(indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                                  RESERVED_STORAGE_BUFFERS)});
+    // Both arrays are visible to every stage, so together they have to fit
+    // one stage's resource limit; share it in proportion when they do not.
+    uint64_t resources = minus_reserved(indexing.maxPerStageUpdateAfterBindResources, RESERVED_RESOURCES);
+    uint64_t wanted = uint64_t(m_textures.capacity) + m_buffers.capacity;
+    if (wanted > resources) {
+        m_textures.capacity = static_cast<uint32_t>(resources * m_textures.capacity / wanted);
+        m_buffers.capacity = static_cast<uint32_t>(resources - m_textures.capacity);
+    }
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = TEXTURE_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = m_textures.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = BUFFER_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = m_buffers.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Partially bound: unused slots may hold nothing. Update after bind and
+    // unused while pending: adding a texture never has to wait for, or
+    // invalidate, recorded or in-flight frames.
+    const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                                  VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorBindingFlags flags[2] = {bindingFlags, bindingFlags};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 2;
+    flagsInfo.pBindingFlags = flags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, host_allocator(), &m_layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+
+    VkDescriptorPoolSize sizes[2] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_textures.capacity},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_buffers.capacity},
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = sizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, host_allocator(), &m_pool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_layout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_set) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+}
+
+void BindlessHeap::deinit(VkDevice device) {
+    if (m_pool) vkDestroyDescriptorPool(device, m_pool, host_allocator());
+    if (m_layout) vkDestroyDescriptorSetLayout(device, m_layout, host_allocator());
+    m_pool = VK_NULL_HANDLE;
+    m_layout = VK_NULL_HANDLE;
+    m_set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::Slots::allocate() {
+    if (!free.empty()) {
+        uint32_t index = free.back();
+        free.pop_back();
+        return index;
+    }
+    if (next == capacity) throw std::runtime_error("bindless descriptor array is full!");
+    return next++;
+}
+
+uint32_t BindlessHeap::add_texture(VkDevice device, VkImageView view, VkSampler sampler, VkImageLayout layout) {
+    uint32_t index = m_textures.allocate();
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = layout;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = TEXTURE_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessHeap::add_buffer(VkDevice device, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    uint32_t index = m_buffers.allocate();
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    return index;
+}
+
+void BindlessHeap::remove_texture(uint32_t index, uint64_t value) {
+    m_textures.retired.push_back({value, index});
+}
+
+void BindlessHeap::remove_buffer(uint32_t index, uint64_t value) {
+    m_buffers.retired.push_back({value, index});
+}
+
+void BindlessHeap::collect(uint64_t completed) {
+    for (Slots* slots : {&m_textures, &m_buffers}) {
+        while (!slots->retired.empty() && slots->retired.front().first <= completed) {
+            slots->free.push_back(slots->retired.front().second);
+            slots->retired.pop_front();
+        }
+    }
+}
+
+void BindlessHeap::bind(VkCommandBuffer command_buffer, VkPipelineLayout layout, VkPipelineBindPoint bind_point) const {
+    if (!enabled()) return;
+    vkCmdBindDescriptorSets(command_buffer, bind_point, layout, 0, 1, &m_set, 0, nullptr);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Per-draw indices into the bindless arrays, pushed as push constants at
+// offset 0. Shaders declare the matching block:
+//   layout(push_constant) uniform Draw { uint texture; uint buffer; uint object; uint material; };
+struct BindlessPush {
+    uint32_t texture = 0;
+    uint32_t buffer = 0;
+    uint32_t object = 0;
+    uint32_t material = 0;
+};
+
+// One descriptor set bound once per command buffer, holding every texture
+// and storage buffer in large update-after-bind arrays:
+//   set 0, binding 0: sampler2D textures[]
+//   set 0, binding 1: buffer   buffers[]
+// Materials and draws refer to resources by array index, so nothing is
+// bound per draw. Needs Vulkan 1.2 descriptor indexing; see supported().
+//
+// Freed slots are only reused once the GPU has passed the value they were
+// released with, since in-flight frames may still index them.
+struct BindlessHeap {
+    static const uint32_t MAX_TEXTURES = 16384;
+    static const uint32_t MAX_BUFFERS = 16384;
+    static const uint32_t TEXTURE_BINDING = 0;
+    static const uint32_t BUFFER_BINDING = 1;
+
+    // Checks the descriptor indexing features the heap relies on. Fill
+    // `features` with vkGetPhysicalDeviceFeatures2 first.
+    static bool supported(const VkPhysicalDeviceVulkan12Features& features);
+    // Sets the features supported() checked on a features struct that goes
+    // into VkDeviceCreateInfo::pNext.
+    static void enable(VkPhysicalDeviceVulkan12Features& features);
+
+    void init(VkPhysicalDevice physical_device, VkDevice device);
+    void deinit(VkDevice device);
+
+    uint32_t add_texture(VkDevice device, VkImageView view, VkSampler sampler,
+                         VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t add_buffer(VkDevice device, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    // `value` is the timeline value of the last submit that may use the slot.
+    void remove_texture(uint32_t index, uint64_t value);
+    void remove_buffer(uint32_t index, uint64_t value);
+    // Makes slots released at or below `completed` reusable.
+    void collect(uint64_t completed);
+
+    void bind(VkCommandBuffer command_buffer, VkPipelineLayout layout,
+              VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+    bool enabled() const { return m_set != VK_NULL_HANDLE; }
+    VkDescriptorSetLayout layout() const { return m_layout; }
+    VkDescriptorSet set() const { return m_set; }
+
+    private:
+    struct Slots {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> free;
+        std::deque<std::pair<uint64_t, uint32_t>> retired;
+
+        uint32_t allocate();
+    };
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    Slots m_textures;
+    Slots m_buffers;
+};
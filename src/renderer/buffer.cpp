@@ -1,8 +1,14 @@
 #include "buffer.h"
+#include "host_allocator.h"
 
 #include <iostream>
 #include <cstring>
 
+void VulkanBuffer::track(MemoryBudget* budget, MemoryCategory category) {
+    m_budget = budget;
+    m_category = category;
+}
+
 bool VulkanBuffer::init(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
     m_size = size;
     if (!create_buffer(physical_device, device, size, usage, properties)) {
@@ -22,7 +28,7 @@ bool VulkanBuffer::create_buffer(VkPhysicalDevice physical_device, VkDevice devi
     bufferCreateInfo.usage = usage;
     bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VkResult result = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &m_buffer);
+    VkResult result = vkCreateBuffer(device, &bufferCreateInfo, host_allocator(), &m_buffer);
     if (result != VK_SUCCESS) {
         std::cout << "Failed to create Vulkan buffer!\n";
         return false;
@@ -38,12 +44,17 @@ bool VulkanBuffer::alloc_memory(VkPhysicalDevice physical_device, VkDevice devic
     memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     memoryAllocateInfo.allocationSize = memoryRequirements.size;
     memoryAllocateInfo.memoryTypeIndex = find_memory_type(physical_device, memoryRequirements.memoryTypeBits, properties);
+    if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX) return false;
+    if (m_budget) m_budget->reserve(memoryAllocateInfo.memoryTypeIndex, memoryRequirements.size);
 
-    VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &m_memory);
+    VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, host_allocator(), &m_memory);
     if (result != VK_SUCCESS) {
         std::cout << "Failed to allocate memory for Vulkan buffer!\n";
         return false;
     }
+    m_memory_type = memoryAllocateInfo.memoryTypeIndex;
+    m_allocation_size = memoryRequirements.size;
+    if (m_budget) m_budget->track(m_memory_type, m_category, static_cast<int64_t>(m_allocation_size));
 
     vkBindBufferMemory(device, m_buffer, m_memory, 0);
     return true;
@@ -59,7 +70,7 @@ uint32_t VulkanBuffer::find_memory_type(VkPhysicalDevice physical_device, uint32
         }
     }
     std::cout << "Failed to find suitable memory type!\n";
-    return -1;
+    return UINT32_MAX;
 }
 
 void VulkanBuffer::copy_data(VkDevice device, const void* data) {
@@ -71,15 +82,29 @@ void VulkanBuffer::copy_data(VkDevice device, const void* data) {
 
 void VulkanBuffer::deinit(VkDevice device) {
     if (m_buffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(device, m_buffer, nullptr);
+        vkDestroyBuffer(device, m_buffer, host_allocator());
         m_buffer = VK_NULL_HANDLE;
     }
     if (m_memory != VK_NULL_HANDLE) {
-        vkFreeMemory(device, m_memory, nullptr);
+        untrack();
+        vkFreeMemory(device, m_memory, host_allocator());
         m_memory = VK_NULL_HANDLE;
     }
 }
 
+void VulkanBuffer::retire(DeletionQueue& queue, uint64_t value) {
+    if (m_memory != VK_NULL_HANDLE) untrack();
+    queue.retire(value, m_buffer);
+    queue.retire(value, m_memory);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+}
+
+void VulkanBuffer::untrack() {
+    if (m_budget) m_budget->track(m_memory_type, m_category, -static_cast<int64_t>(m_allocation_size));
+    m_allocation_size = 0;
+}
+
 VkBuffer VulkanBuffer::get_buffer() const {
     return m_buffer;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "deletion_queue.h"
+#include "memory_budget.h"
+
 #include <vulkan/vulkan.h>
 #include <vector>
 
@@ -8,14 +11,26 @@ public:
     VkBuffer m_buffer = VK_NULL_HANDLE;
     VkDeviceMemory m_memory = VK_NULL_HANDLE;
     VkDeviceSize m_size = 0;
+    // Optional; set before init() to report the memory to `budget`.
+    void track(MemoryBudget* budget, MemoryCategory category);
     bool init(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
     void copy_data(VkDevice device, const void* data);
     void deinit(VkDevice device);
+    // Like deinit(), but destruction waits until `value` completes. Use it
+    // when a submitted frame may still read the buffer.
+    void retire(DeletionQueue& queue, uint64_t value);
     VkBuffer get_buffer() const;
     VkDeviceSize get_size() const;
 
 private:
     bool create_buffer(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
     bool alloc_memory(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize size, VkMemoryPropertyFlags properties);
+    // UINT32_MAX when no memory type fits.
     uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
+    void untrack();
+
+    MemoryBudget* m_budget = nullptr;
+    MemoryCategory m_category = MemoryCategory::OTHER;
+    uint32_t m_memory_type = 0;
+    VkDeviceSize m_allocation_size = 0;
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "deletion_queue.h"
+#include "host_allocator.h"
+
+// Non-dispatchable handles are 64-bit on every target, so one integer
+// holds any of them.
+template <typename T>
+static uint64_t to_bits(T handle) { return (uint64_t) handle; }
+
+template <typename T>
+static T from_bits(uint64_t bits) { return (T) bits; }
+
+void DeletionQueue::push(uint64_t value, uint64_t handle, Kind kind) {
+    if (handle == 0) return;
+    if (!m_entries.empty() && value < m_entries.back().value) value = m_entries.back().value;
+    m_entries.push_back({value, handle, kind});
+}
+
+void DeletionQueue::retire(uint64_t value, VkBuffer buffer) { push(value, to_bits(buffer), Kind::BUFFER); }
+void DeletionQueue::retire(uint64_t value, VkDeviceMemory memory) { push(value, to_bits(memory), Kind::MEMORY); }
+void DeletionQueue::retire(uint64_t value, VkImage image) { push(value, to_bits(image), Kind::IMAGE); }
+void DeletionQueue::retire(uint64_t value, VkImageView view) { push(value, to_bits(view), Kind::IMAGE_VIEW); }
+void DeletionQueue::retire(uint64_t value, VkSampler sampler) { push(value, to_bits(sampler), Kind::SAMPLER); }
+void DeletionQueue::retire(uint64_t value, VkPipeline pipeline) { push(value, to_bits(pipeline), Kind::PIPELINE); }
+void DeletionQueue::retire(uint64_t value, VkPipelineLayout layout) { push(value, to_bits(layout), Kind::PIPELINE_LAYOUT); }
+void DeletionQueue::retire(uint64_t value, VkShaderModule module) { push(value, to_bits(module), Kind::SHADER_MODULE); }
+void DeletionQueue::retire(uint64_t value, VkFramebuffer framebuffer) { push(value, to_bits(framebuffer), Kind::FRAMEBUFFER); }
+void DeletionQueue::retire(uint64_t value, VkDescriptorPool pool) { push(value, to_bits(pool), Kind::DESCRIPTOR_POOL); }
+
+void DeletionQueue::collect(VkDevice device, uint64_t completed) {
+    while (!m_entries.empty() && m_entries.front().value <= completed) {
+        destroy(device, m_entries.front());
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::destroy(VkDevice device, const Entry& entry) {
+    switch (entry.kind) {
+        case Kind::BUFFER: vkDestroyBuffer(device, from_bits<VkBuffer>(entry.handle), host_allocator()); break;
+        case Kind::MEMORY: vkFreeMemory(device, from_bits<VkDeviceMemory>(entry.handle), host_allocator()); break;
+        case Kind::IMAGE: vkDestroyImage(device, from_bits<VkImage>(entry.handle), host_allocator()); break;
+        case Kind::IMAGE_VIEW: vkDestroyImageView(device, from_bits<VkImageView>(entry.handle), host_allocator()); break;
+        case Kind::SAMPLER: vkDestroySampler(device, from_bits<VkSampler>(entry.handle), host_allocator()); break;
+        case Kind::PIPELINE: vkDestroyPipeline(device, from_bits<VkPipeline>(entry.handle), host_allocator()); break;
+        case Kind::PIPELINE_LAYOUT: vkDestroyPipelineLayout(device, from_bits<VkPipelineLayout>(entry.handle), host_allocator()); break;
+        case Kind::SHADER_MODULE: vkDestroyShaderModule(device, from_bits<VkShaderModule>(entry.handle), host_allocator()); break;
+        case Kind::FRAMEBUFFER: vkDestroyFramebuffer(device, from_bits<VkFramebuffer>(entry.handle), host_allocator()); break;
+        case Kind::DESCRIPTOR_POOL: vkDestroyDescriptorPool(device, from_bits<VkDescriptorPool>(entry.handle), host_allocator()); break;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+
+// Vulkan objects the GPU may still be using. Each one is retired with the
+// timeline value of the last submit that used it and destroyed by
+// collect() once that value has completed, so resources can be replaced
+// mid-flight without vkDeviceWaitIdle.
+//
+// Values are expected in non-decreasing order (usually the owning queue's
+// submitted() + 1); an older value is bumped to the newest one, which is
+// always safe. Not thread-safe: retire and collect from the render thread.
+struct DeletionQueue {
+    void retire(uint64_t value, VkBuffer buffer);
+    void retire(uint64_t value, VkDeviceMemory memory);
+    void retire(uint64_t value, VkImage image);
+    void retire(uint64_t value, VkImageView view);
+    void retire(uint64_t value, VkSampler sampler);
+    void retire(uint64_t value, VkPipeline pipeline);
+    void retire(uint64_t value, VkPipelineLayout layout);
+    void retire(uint64_t value, VkShaderModule module);
+    void retire(uint64_t value, VkFramebuffer framebuffer);
+    void retire(uint64_t value, VkDescriptorPool pool);
+
+    // Destroys everything retired at or below `completed`.
+    void collect(VkDevice device, uint64_t completed);
+    // Destroys everything; the device must be idle.
+    void flush(VkDevice device) { collect(device, UINT64_MAX); }
+
+    size_t pending() const { return m_entries.size(); }
+
+    private:
+    enum class Kind : uint8_t {
+        BUFFER, MEMORY, IMAGE, IMAGE_VIEW, SAMPLER, PIPELINE, PIPELINE_LAYOUT, SHADER_MODULE, FRAMEBUFFER,
+        DESCRIPTOR_POOL
+    };
+
+    struct Entry {
+        uint64_t value;
+        uint64_t handle;
+        Kind kind;
+    };
+
+    std::deque<Entry> m_entries;
+
+    void push(uint64_t value, uint64_t handle, Kind kind);
+    static void destroy(VkDevice device, const Entry& entry);
+};
@@ -0,0 +1,208 @@
+#include "descriptors.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static const DescriptorAllocator::PoolRatio pool_ratios[] = {
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f},
+};
+
+// ---------------- allocator ----------------
+void DescriptorAllocator::init(VkDevice device) {
+    m_device = device;
+}
+
+void DescriptorAllocator::deinit() {
+    for (VkDescriptorPool pool : m_used) vkDestroyDescriptorPool(m_device, pool, host_allocator());
+    for (VkDescriptorPool pool : m_free) vkDestroyDescriptorPool(m_device, pool, host_allocator());
+    m_used.clear();
+    m_free.clear();
+    m_current = VK_NULL_HANDLE;
+}
+
+VkDescriptorPool DescriptorAllocator::grab_pool() {
+    if (!m_free.empty()) {
+        VkDescriptorPool pool = m_free.back();
+        m_free.pop_back();
+        m_used.push_back(pool);
+        return pool;
+    }
+
+    // Each new pool is bigger than the last, so a frame that needs many sets
+    // settles on a few large pools after the first reset.
+    uint32_t sets = m_next_pool_sets;
+    m_next_pool_sets = std::min(MAX_POOL_SETS, m_next_pool_sets * 2);
+
+    std::vector<VkDescriptorPoolSize> sizes;
+    for (const PoolRatio& ratio : pool_ratios)
+        sizes.push_back({ratio.type, std::max(1u, static_cast<uint32_t>(ratio.per_set * sets))});
+
+    VkDescriptorPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    info.maxSets = sets;
+    info.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    info.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(m_device, &info, host_allocator(), &pool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor pool!");
+    m_used.push_back(pool);
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if (!m_current) m_current = grab_pool();
+
+    VkDescriptorSetAllocateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.descriptorPool = m_current;
+    info.descriptorSetCount = 1;
+    info.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(m_device, &info, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        m_current = grab_pool();
+        info.descriptorPool = m_current;
+        result = vkAllocateDescriptorSets(m_device, &info, &set);
+    }
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate descriptor set!");
+    return set;
+}
+
+void DescriptorAllocator::reset() {
+    for (VkDescriptorPool pool : m_used) {
+        vkResetDescriptorPool(m_device, pool, 0);
+        m_free.push_back(pool);
+    }
+    m_used.clear();
+    m_current = VK_NULL_HANDLE;
+}
+
+// ---------------- layout cache ----------------
+void DescriptorLayoutCache::init(VkDevice device) {
+    m_device = device;
+}
+
+void DescriptorLayoutCache::deinit() {
+    for (auto& [key, layout] : m_layouts) vkDestroyDescriptorSetLayout(m_device, layout, host_allocator());
+    m_layouts.clear();
+}
+
+bool DescriptorLayoutCache::Key::operator==(const Key& other) const {
+    if (flags != other.flags || bindings.size() != other.bindings.size()) return false;
+    for (size_t i = 0; i < bindings.size(); i++) {
+        const VkDescriptorSetLayoutBinding& a = bindings[i];
+        const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags ||
+            a.pImmutableSamplers != b.pImmutableSamplers)
+            return false;
+    }
+    return true;
+}
+
+size_t DescriptorLayoutCache::KeyHash::operator()(const Key& key) const {
+    // FNV-1a over the fields operator== compares.
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    mix(key.flags);
+    for (const VkDescriptorSetLayoutBinding& b : key.bindings) {
+        mix(b.binding);
+        mix(static_cast<uint64_t>(b.descriptorType));
+        mix(b.descriptorCount);
+        mix(b.stageFlags);
+    }
+    return static_cast<size_t>(hash);
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(std::vector<VkDescriptorSetLayoutBinding> bindings,
+                                                 VkDescriptorSetLayoutCreateFlags flags) {
+    std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+
+    Key key{std::move(bindings), flags};
+    auto it = m_layouts.find(key);
+    if (it != m_layouts.end()) return it->second;
+
+    VkDescriptorSetLayoutCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.flags = flags;
+    info.bindingCount = static_cast<uint32_t>(key.bindings.size());
+    info.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(m_device, &info, host_allocator(), &layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+    m_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+// ---------------- pipeline layout cache ----------------
+void PipelineLayoutCache::init(VkDevice device) {
+    m_device = device;
+}
+
+void PipelineLayoutCache::deinit() {
+    for (auto& [key, layout] : m_layouts) vkDestroyPipelineLayout(m_device, layout, host_allocator());
+    m_layouts.clear();
+}
+
+bool PipelineLayoutCache::Key::operator==(const Key& other) const {
+    if (set_layouts != other.set_layouts || push_ranges.size() != other.push_ranges.size()) return false;
+    for (size_t i = 0; i < push_ranges.size(); i++) {
+        const VkPushConstantRange& a = push_ranges[i];
+        const VkPushConstantRange& b = other.push_ranges[i];
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size) return false;
+    }
+    return true;
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    for (VkDescriptorSetLayout layout : key.set_layouts) mix((uint64_t) layout);
+    for (const VkPushConstantRange& range : key.push_ranges) {
+        mix(range.stageFlags);
+        mix(range.offset);
+        mix(range.size);
+    }
+    return static_cast<size_t>(hash);
+}
+
+VkPipelineLayout PipelineLayoutCache::get(const std::vector<VkDescriptorSetLayout>& set_layouts,
+                                          const std::vector<VkPushConstantRange>& push_ranges) {
+    Key key{set_layouts, push_ranges};
+    auto it = m_layouts.find(key);
+    if (it != m_layouts.end()) return it->second;
+
+    VkPipelineLayoutCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+    info.pSetLayouts = set_layouts.data();
+    info.pushConstantRangeCount = static_cast<uint32_t>(push_ranges.size());
+    info.pPushConstantRanges = push_ranges.data();
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(m_device, &info, host_allocator(), &layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline layout!");
+    m_layouts.emplace(std::move(key), layout);
+    return layout;
+}
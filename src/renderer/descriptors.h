@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hands out descriptor sets from a growing list of pools. Sets are never
+// freed one by one: reset() recycles every pool with vkResetDescriptorPool,
+// so allocation is a bump in the current pool and a full pool just moves on
+// to the next one instead of failing. One allocator per frame in flight,
+// reset once that frame's slot has been waited on.
+struct DescriptorAllocator {
+    // Descriptors per set of each type in a new pool, from typical material
+    // and pass layouts; the counts scale with the pool's set count.
+    struct PoolRatio {
+        VkDescriptorType type;
+        float per_set;
+    };
+
+    static const uint32_t FIRST_POOL_SETS = 256;
+    static const uint32_t MAX_POOL_SETS = 4096;
+
+    void init(VkDevice device);
+    void deinit();
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    // Every set handed out since the last reset becomes invalid.
+    void reset();
+
+    uint32_t pool_count() const { return static_cast<uint32_t>(m_used.size() + m_free.size()); }
+
+    private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkDescriptorPool m_current = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> m_used;
+    std::vector<VkDescriptorPool> m_free;
+    uint32_t m_next_pool_sets = FIRST_POOL_SETS;
+
+    VkDescriptorPool grab_pool();
+};
+
+// Deduplicates descriptor set layouts. Keyed by the bindings (sorted by
+// binding number) so equal layouts built in different places share one
+// VkDescriptorSetLayout, which keeps pipeline layouts compatible and set
+// binds rarer. Layouts live until deinit().
+struct DescriptorLayoutCache {
+    void init(VkDevice device);
+    void deinit();
+
+    VkDescriptorSetLayout get(std::vector<VkDescriptorSetLayoutBinding> bindings,
+                              VkDescriptorSetLayoutCreateFlags flags = 0);
+
+    uint32_t size() const { return static_cast<uint32_t>(m_layouts.size()); }
+
+    private:
+    struct Key {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        VkDescriptorSetLayoutCreateFlags flags;
+
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> m_layouts;
+};
+
+// Deduplicates pipeline layouts by their set layouts and push constant
+// ranges. Pipelines that share a layout keep their bound sets across
+// pipeline switches. Layouts live until deinit().
+struct PipelineLayoutCache {
+    void init(VkDevice device);
+    void deinit();
+
+    VkPipelineLayout get(const std::vector<VkDescriptorSetLayout>& set_layouts,
+                         const std::vector<VkPushConstantRange>& push_ranges);
+
+    uint32_t size() const { return static_cast<uint32_t>(m_layouts.size()); }
+
+    private:
+    struct Key {
+        std::vector<VkDescriptorSetLayout> set_layouts;
+        std::vector<VkPushConstantRange> push_ranges;
+
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<Key, VkPipelineLayout, KeyHash> m_layouts;
+};
@@ -1,4 +1,5 @@
 #include "device.h"
+#include "host_allocator.h"
 
 #include <cstring>
 #include <iostream>
@@ -24,15 +25,15 @@ Device::Device(Window &window) : m_window{window} {
 }
 
 Device::~Device() {
-    vkDestroyCommandPool(m_device, m_command_pool, nullptr);
-    vkDestroyDevice(m_device, nullptr);
+    vkDestroyCommandPool(m_device, m_command_pool, host_allocator());
+    vkDestroyDevice(m_device, host_allocator());
 
     if (enable_validation_layers) {
-        destroy_debug_utils_messenger_ext(m_instance, m_debug_messenger, nullptr);
+        destroy_debug_utils_messenger_ext(m_instance, m_debug_messenger, host_allocator());
     }
 
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-    vkDestroyInstance(m_instance, nullptr);
+    vkDestroySurfaceKHR(m_instance, m_surface, host_allocator());
+    vkDestroyInstance(m_instance, host_allocator());
 }
 
 void Device::create_instance() {
@@ -46,7 +47,13 @@ void Device::create_instance() {
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = "No Engine";
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 makes VK_KHR_dynamic_rendering's dependencies core. A 1.0 loader
+    // rejects anything newer, so only ask for it when the loader has it.
+    uint32_t loader_version = VK_API_VERSION_1_0;
+    auto enumerate_version = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    if (enumerate_version) enumerate_version(&loader_version);
+    app_info.apiVersion = loader_version >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+    m_instance_version = app_info.apiVersion;
 
     VkInstanceCreateInfo create_info = {};
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -68,7 +75,7 @@ void Device::create_instance() {
         create_info.pNext = nullptr;
     }
 
-    if (vkCreateInstance(&create_info, nullptr, &m_instance) != VK_SUCCESS) {
+    if (vkCreateInstance(&create_info, host_allocator(), &m_instance) != VK_SUCCESS) {
         throw std::runtime_error("failed to create instance!");
     }
 
@@ -132,7 +139,8 @@ void Device::create_logical_device() {
     QueueFamilyIndices indices = find_queue_families(m_physical_device);
 
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value()};
+    std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value(),
+                                                indices.compute_family.value(), indices.transfer_family.value()};
 
     float queue_priority = 1.0f;
     for (uint32_t queue_family : unique_queue_families) {
@@ -153,9 +161,27 @@ void Device::create_logical_device() {
     create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     create_info.pQueueCreateInfos = queue_create_infos.data();
 
+    // Dynamic rendering when the device has it (core in 1.3, an extension
+    // on 1.2); otherwise passes fall back to VkRenderPass/VkFramebuffer.
+    std::vector<const char *> extensions = m_device_extensions;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+    dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &dynamic_rendering_features;
+    if (m_instance_version >= VK_API_VERSION_1_2 && m_properties.apiVersion >= VK_API_VERSION_1_2 &&
+        has_device_extension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        vkGetPhysicalDeviceFeatures2(m_physical_device, &features2);
+        m_dynamic_rendering = dynamic_rendering_features.dynamicRendering;
+    }
+    if (m_dynamic_rendering) {
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        create_info.pNext = &dynamic_rendering_features;
+    }
+
     create_info.pEnabledFeatures = &device_features;
-    create_info.enabledExtensionCount = static_cast<uint32_t>(m_device_extensions.size());
-    create_info.ppEnabledExtensionNames = m_device_extensions.data();
+    create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
 
     if (enable_validation_layers) {
         create_info.enabledLayerCount = static_cast<uint32_t>(m_validation_layers.size());
@@ -164,12 +190,14 @@ void Device::create_logical_device() {
         create_info.enabledLayerCount = 0;
     }
 
-    if (vkCreateDevice(m_physical_device, &create_info, nullptr, &m_device) != VK_SUCCESS) {
+    if (vkCreateDevice(m_physical_device, &create_info, host_allocator(), &m_device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device!");
     }
 
     vkGetDeviceQueue(m_device, indices.graphics_family.value(), 0, &m_graphics_queue);
     vkGetDeviceQueue(m_device, indices.present_family.value(), 0, &m_present_queue);
+    vkGetDeviceQueue(m_device, indices.compute_family.value(), 0, &m_compute_queue);
+    vkGetDeviceQueue(m_device, indices.transfer_family.value(), 0, &m_transfer_queue);
 }
 
 void Device::create_command_pool() {
@@ -181,7 +209,7 @@ void Device::create_command_pool() {
     pool_info.flags =
         VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-    if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
+    if (vkCreateCommandPool(m_device, &pool_info, host_allocator(), &m_command_pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
 }
@@ -225,7 +253,7 @@ void Device::setup_debug_messenger() {
     VkDebugUtilsMessengerCreateInfoEXT createInfo;
     populate_debug_messenger_create_info(createInfo);
 
-    if (create_debug_utils_messenger_ext(m_instance, &createInfo, nullptr, &m_debug_messenger) != VK_SUCCESS) {
+    if (create_debug_utils_messenger_ext(m_instance, &createInfo, host_allocator(), &m_debug_messenger) != VK_SUCCESS) {
         throw std::runtime_error("failed to set up debug messenger!");
     }
 }
@@ -366,9 +394,35 @@ QueueFamilyIndices Device::find_queue_families(VkPhysicalDevice device) {
         i++;
     }
 
+    // Async compute / transfer: prefer families without graphics so the work
+    // runs beside the graphics queue instead of being serialized on it.
+    for (uint32_t j = 0; j < queue_family_count; j++) {
+        VkQueueFlags flags = queue_families[j].queueFlags;
+        if (queue_families[j].queueCount == 0) continue;
+        if (!indices.compute_family && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            indices.compute_family = j;
+        if (!indices.transfer_family && (flags & VK_QUEUE_TRANSFER_BIT) &&
+            !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            indices.transfer_family = j;
+    }
+    if (!indices.compute_family) indices.compute_family = indices.graphics_family;
+    if (!indices.transfer_family) indices.transfer_family = indices.compute_family;
+
     return indices;
 }
 
+bool Device::has_device_extension(const char *name) {
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, available_extensions.data());
+
+    for (const auto &extension : available_extensions) {
+        if (strcmp(extension.extensionName, name) == 0) return true;
+    }
+    return false;
+}
+
 QueueFamilyIndices Device::find_physical_queue_families() {
     return find_queue_families(m_physical_device);
 }
@@ -7,6 +7,9 @@
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
+    // Dedicated families when the device has them, else the graphics family.
+    std::optional<uint32_t> compute_family;
+    std::optional<uint32_t> transfer_family;
 
     bool is_complete();
 };
@@ -43,6 +46,9 @@ struct Device {
     VkSurfaceKHR surface() { return m_surface; }
     VkQueue graphics_queue() { return m_graphics_queue; }
     VkQueue present_queue() { return m_present_queue; }
+    VkQueue compute_queue() { return m_compute_queue; }
+    VkQueue transfer_queue() { return m_transfer_queue; }
+    bool dynamic_rendering() { return m_dynamic_rendering; }
 
     SwapChainSupportDetails get_swap_chain_support();
     uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties);
@@ -78,6 +84,11 @@ struct Device {
     VkSurfaceKHR m_surface;
     VkQueue m_graphics_queue;
     VkQueue m_present_queue;
+    VkQueue m_compute_queue;
+    VkQueue m_transfer_queue;
+    bool m_dynamic_rendering = false;
+    // apiVersion the instance was created with.
+    uint32_t m_instance_version = VK_API_VERSION_1_0;
 
     const std::vector<const char *> m_validation_layers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> m_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -95,5 +106,6 @@ struct Device {
     void populate_debug_messenger_create_info(VkDebugUtilsMessengerCreateInfoEXT &create_info);
     void has_glfw_required_instance_extensions();
     bool check_device_extension_support(VkPhysicalDevice device);
+    bool has_device_extension(const char *name);
     SwapChainSupportDetails query_swap_chain_support(VkPhysicalDevice device);
 };
\ No newline at end of file
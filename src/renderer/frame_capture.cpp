@@ -0,0 +1,204 @@
+#include "frame_capture.h"
+#include "host_allocator.h"
+#include "../profiler/profiler.h"
+#include "../utils/image_write.h"
+
+#include <iostream>
+#include <stdexcept>
+
+static uint32_t find_readback_memory(VkPhysicalDevice physical_device, uint32_t type_bits, bool& coherent) {
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    // Cached memory makes the CPU-side read fast; coherent is the fallback.
+    const VkMemoryPropertyFlags preferred[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+    for (VkMemoryPropertyFlags wanted : preferred) {
+        for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+            VkMemoryPropertyFlags flags = properties.memoryTypes[i].propertyFlags;
+            if ((type_bits & (1u << i)) && (flags & wanted) == wanted) {
+                coherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                return i;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+void FrameCapture::init(VkPhysicalDevice physical_device, VkDevice device, VkExtent2D extent, VkFormat format, uint32_t frame_count,
+                        JobSystem* jobs, MemoryBudget* budget) {
+    m_extent = extent;
+    m_jobs = jobs;
+    m_budget = budget;
+    m_bgra = format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM;
+    if (!m_bgra && format != VK_FORMAT_R8G8B8A8_SRGB && format != VK_FORMAT_R8G8B8A8_UNORM) {
+        std::cout << "Frame capture does not support this color format, capture disabled\n";
+        return;
+    }
+
+    VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+    for (uint32_t i = 0; i < frame_count; i++) {
+        auto slot = std::make_unique<Slot>();
+
+        VkBufferCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        info.size = size;
+        info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(device, &info, host_allocator(), &slot->buffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to create capture buffer!");
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, slot->buffer, &requirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = find_readback_memory(physical_device, requirements.memoryTypeBits, slot->coherent);
+        if (allocInfo.memoryTypeIndex == UINT32_MAX)
+            throw std::runtime_error("no host-visible memory for frame capture!");
+        if (m_budget) m_budget->reserve(allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+        if (vkAllocateMemory(device, &allocInfo, host_allocator(), &slot->memory) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate capture memory!");
+        slot->memory_type = allocInfo.memoryTypeIndex;
+        slot->size = allocInfo.allocationSize;
+        if (m_budget) m_budget->track(slot->memory_type, MemoryCategory::STAGING, static_cast<int64_t>(slot->size));
+
+        vkBindBufferMemory(device, slot->buffer, slot->memory, 0);
+        vkMapMemory(device, slot->memory, 0, VK_WHOLE_SIZE, 0, &slot->mapped);
+        m_slots.push_back(std::move(slot));
+    }
+    m_enabled = true;
+}
+
+void FrameCapture::deinit(VkDevice device) {
+    if (!m_enabled) return;
+
+    // Captures requested in the last frames never reach begin_frame() again.
+    vkDeviceWaitIdle(device);
+    for (auto& slot : m_slots) {
+        if (slot->in_flight) encode(device, *slot);
+    }
+    if (m_jobs) m_jobs->wait(m_counter);
+
+    for (auto& slot : m_slots) {
+        vkUnmapMemory(device, slot->memory);
+        vkDestroyBuffer(device, slot->buffer, host_allocator());
+        vkFreeMemory(device, slot->memory, host_allocator());
+        if (m_budget) m_budget->track(slot->memory_type, MemoryCategory::STAGING, -static_cast<int64_t>(slot->size));
+    }
+    m_slots.clear();
+    m_requests.clear();
+    m_enabled = false;
+}
+
+void FrameCapture::request(const std::string& path, CaptureFormat format) {
+    if (!m_enabled) {
+        std::cout << "Frame capture unavailable, skipping " << path << "\n";
+        return;
+    }
+    m_requests.push_back({path, format});
+}
+
+void FrameCapture::begin_frame(VkDevice device, uint32_t frame) {
+    if (!m_enabled) return;
+    m_frame = frame;
+    Slot& slot = *m_slots[frame];
+    if (slot.in_flight) encode(device, slot);
+}
+
+void FrameCapture::record(VkCommandBuffer command_buffer, VkImage image, VkImageLayout layout) {
+    if (!m_enabled || m_requests.empty()) return;
+
+    // The slot's previous capture may still be encoding; try next frame.
+    Slot& slot = *m_slots[m_frame];
+    if (slot.in_flight || slot.encoding.load(std::memory_order_acquire)) return;
+
+    PROFILE_ZONE("capture copy");
+    slot.request = std::move(m_requests.front());
+    m_requests.pop_front();
+    slot.in_flight = true;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {m_extent.width, m_extent.height, 1};
+    vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = layout;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    VkBufferMemoryBarrier host{};
+    host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.buffer = slot.buffer;
+    host.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 0, nullptr, 1, &host, 0, nullptr);
+}
+
+// The copy has completed (its frame finished). The buffer stays reserved
+// until the worker is done reading it.
+void FrameCapture::encode(VkDevice device, Slot& slot) {
+    slot.in_flight = false;
+    if (!slot.coherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.memory;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+    slot.encoding.store(true, std::memory_order_relaxed);
+
+    Slot* target = &slot;
+    VkExtent2D extent = m_extent;
+    bool bgra = m_bgra;
+    auto job = [target, extent, bgra]() {
+        const uint8_t* src = static_cast<const uint8_t*>(target->mapped);
+        size_t pixels = size_t(extent.width) * extent.height;
+        bool png = target->request.format == CaptureFormat::PNG;
+        uint32_t channels = png ? 4 : 3;
+
+        std::vector<uint8_t> out(pixels * channels);
+        for (size_t i = 0; i < pixels; i++) {
+            const uint8_t* p = src + i * 4;
+            uint8_t* q = out.data() + i * channels;
+            q[0] = bgra ? p[2] : p[0];
+            q[1] = p[1];
+            q[2] = bgra ? p[0] : p[2];
+            if (png) q[3] = p[3];
+        }
+        std::string path = std::move(target->request.path);
+        target->encoding.store(false, std::memory_order_release);
+
+        bool ok = png ? write_png(path, out.data(), extent.width, extent.height, 4)
+                      : write_ppm(path, out.data(), extent.width, extent.height);
+        std::cout << (ok ? "Captured " : "Failed to write capture ") << path << "\n";
+    };
+
+    if (m_jobs) m_jobs->run("capture encode", job, &m_counter);
+    else job();
+}
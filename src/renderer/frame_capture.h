@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../jobs/job_system.h"
+#include "memory_budget.h"
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class CaptureFormat { PNG, PPM };
+
+// Non-blocking frame readback. A requested capture is copied into a
+// host-visible buffer owned by the current frame-in-flight slot. The slot is
+// picked up again once that frame has completed (MAX_FRAMES_IN_FLIGHT frames
+// later, where the renderer waits anyway), and the pixels are encoded on a
+// worker. The render loop only pays for the copy.
+//
+// request() and the per-frame hooks must be called from the render thread.
+struct FrameCapture {
+    // The readback ring is tracked in `budget` as STAGING when given.
+    void init(VkPhysicalDevice physical_device, VkDevice device, VkExtent2D extent, VkFormat format, uint32_t frame_count,
+              JobSystem* jobs, MemoryBudget* budget = nullptr);
+    // Waits for outstanding copies and encodes, then frees the ring.
+    void deinit(VkDevice device);
+
+    // Captures the next frame that gets recorded.
+    void request(const std::string& path, CaptureFormat format = CaptureFormat::PNG);
+    bool enabled() const { return m_enabled; }
+
+    // After the slot's frame wait: hands a finished copy to the encoder.
+    void begin_frame(VkDevice device, uint32_t frame);
+    // After the last pass: records the copy if a capture is pending.
+    // `layout` is the image's layout at this point; it is restored afterwards.
+    void record(VkCommandBuffer command_buffer, VkImage image, VkImageLayout layout);
+
+    private:
+    struct Request {
+        std::string path;
+        CaptureFormat format;
+    };
+
+    struct Slot {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint32_t memory_type = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+        bool coherent = true;
+        bool in_flight = false;              // copy recorded, frame not yet complete
+        std::atomic<bool> encoding{false};   // worker still reading `mapped`
+        Request request;
+    };
+
+    bool m_enabled = false;
+    VkExtent2D m_extent{};
+    bool m_bgra = false;
+    uint32_t m_frame = 0;
+    JobSystem* m_jobs = nullptr;
+    MemoryBudget* m_budget = nullptr;
+    JobCounter m_counter;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::deque<Request> m_requests;
+
+    void encode(VkDevice device, Slot& slot);
+};
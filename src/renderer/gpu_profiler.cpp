@@ -0,0 +1,105 @@
+#include "gpu_profiler.h"
+#include "host_allocator.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+void GpuProfiler::init(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_family, uint32_t frame_count) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, families.data());
+
+    uint32_t valid_bits = families[queue_family].timestampValidBits;
+    if (valid_bits == 0 || properties.limits.timestampPeriod == 0.0f) {
+        std::cout << "GPU timestamps not supported on this queue, GPU timing disabled\n";
+        return;
+    }
+
+    m_enabled = true;
+    m_period_ns = properties.limits.timestampPeriod;
+    m_valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    m_frames.resize(frame_count);
+
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = MAX_SCOPES * 2;
+
+    for (auto& frame : m_frames) {
+        if (vkCreateQueryPool(device, &info, host_allocator(), &frame.pool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create timestamp query pool!");
+    }
+}
+
+void GpuProfiler::deinit(VkDevice device) {
+    for (auto& frame : m_frames)
+        vkDestroyQueryPool(device, frame.pool, host_allocator());
+    m_frames.clear();
+    m_enabled = false;
+}
+
+void GpuProfiler::begin_frame(VkDevice device, VkCommandBuffer command_buffer, uint32_t frame) {
+    if (!m_enabled) return;
+
+    // The caller has waited for this slot's frame, so its queries are final.
+    m_frame = frame;
+    FrameQueries& queries = m_frames[frame];
+    if (queries.recorded) resolve(device, queries);
+
+    vkCmdResetQueryPool(command_buffer, queries.pool, 0, MAX_SCOPES * 2);
+    queries.names.clear();
+    queries.cpu_ticks = profiler_now();
+    queries.recorded = true;
+}
+
+uint32_t GpuProfiler::begin_scope(VkCommandBuffer command_buffer, const char* name) {
+    if (!m_enabled) return UINT32_MAX;
+
+    FrameQueries& queries = m_frames[m_frame];
+    if (queries.names.size() == MAX_SCOPES) return UINT32_MAX;
+
+    uint32_t scope = static_cast<uint32_t>(queries.names.size());
+    queries.names.push_back(name);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool, scope * 2);
+    return scope;
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer command_buffer, uint32_t scope) {
+    if (scope == UINT32_MAX) return;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_frame].pool, scope * 2 + 1);
+}
+
+void GpuProfiler::resolve(VkDevice device, FrameQueries& frame) {
+    uint32_t count = static_cast<uint32_t>(frame.names.size()) * 2;
+    if (count == 0) return;
+
+    std::vector<uint64_t> results(count);
+    VkResult result = vkGetQueryPoolResults(device, frame.pool, 0, count, results.size() * sizeof(uint64_t),
+                                            results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return;
+
+    m_timings.clear();
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        results[i] &= m_valid_mask;
+        first = std::min(first, results[i]);
+        last = std::max(last, results[i]);
+    }
+
+    for (size_t i = 0; i < frame.names.size(); ++i) {
+        double begin_ns = double(results[i * 2] - first) * m_period_ns;
+        double end_ns = double(results[i * 2 + 1] - first) * m_period_ns;
+        m_timings.push_back({frame.names[i], (end_ns - begin_ns) / 1e6});
+#ifdef RUNE_PROFILE
+        profiler_push_gpu_zone(frame.names[i], frame.cpu_ticks, begin_ns, end_ns);
+#endif
+    }
+    m_frame_ms = double(last - first) * m_period_ns / 1e6;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+struct GpuPassTiming {
+    const char* name;
+    double ms;
+};
+
+// Timestamp queries around passes and dispatches. Each frame in flight has
+// its own query pool; a slot is only read back once its frame has
+// completed, so results are always N frames old and never stall.
+struct GpuProfiler {
+    static const uint32_t MAX_SCOPES = 32;
+
+    void init(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_family, uint32_t frame_count);
+    void deinit(VkDevice device);
+
+    // Must be recorded outside a render pass, before any begin_scope().
+    void begin_frame(VkDevice device, VkCommandBuffer command_buffer, uint32_t frame);
+    uint32_t begin_scope(VkCommandBuffer command_buffer, const char* name);
+    void end_scope(VkCommandBuffer command_buffer, uint32_t scope);
+
+    bool enabled() const { return m_enabled; }
+    // Latest resolved frame: one entry per scope, plus the total GPU frame time.
+    const std::vector<GpuPassTiming>& timings() const { return m_timings; }
+    double frame_ms() const { return m_frame_ms; }
+
+    private:
+    struct FrameQueries {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<const char*> names;
+        uint64_t cpu_ticks = 0;
+        bool recorded = false;
+    };
+
+    bool m_enabled = false;
+    double m_period_ns = 1.0;
+    uint64_t m_valid_mask = ~0ull;
+    uint32_t m_frame = 0;
+    std::vector<FrameQueries> m_frames;
+    std::vector<GpuPassTiming> m_timings;
+    double m_frame_ms = 0.0;
+
+    void resolve(VkDevice device, FrameQueries& frame);
+};
+
+// Times everything recorded between construction and destruction.
+struct GpuScope {
+    GpuProfiler& m_profiler;
+    VkCommandBuffer m_command_buffer;
+    uint32_t m_scope;
+
+    GpuScope(GpuProfiler& profiler, VkCommandBuffer command_buffer, const char* name)
+        : m_profiler(profiler), m_command_buffer(command_buffer), m_scope(profiler.begin_scope(command_buffer, name)) {}
+    ~GpuScope() { m_profiler.end_scope(m_command_buffer, m_scope); }
+
+    GpuScope(const GpuScope &) = delete;
+    GpuScope &operator=(const GpuScope &) = delete;
+};
@@ -0,0 +1,278 @@
+#include "host_allocator.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+static const uint32_t SIZE_CLASS_COUNT = 9;
+static const size_t MIN_CLASS = 16;
+static const size_t MAX_CLASS = MIN_CLASS << (SIZE_CLASS_COUNT - 1);
+static const size_t CHUNK_SIZE = 64 << 10;
+static const size_t ARENA_SIZE = 256 << 10;
+// Chunks and arenas are aligned to the largest class, so every block is
+// aligned to its own size.
+static const size_t CHUNK_ALIGNMENT = MAX_CLASS;
+
+static const uint8_t KIND_LARGE = 0xff;
+static const uint8_t KIND_ARENA = 0xfe;
+
+// Sits right before every pointer handed out. The gap before it pads the
+// block start up to the requested alignment.
+struct Header {
+    // Owning arena, for KIND_ARENA.
+    void* arena;
+    uint32_t size;
+    uint16_t pad;
+    // Size class index, KIND_LARGE or KIND_ARENA.
+    uint8_t kind;
+    uint8_t scope;
+};
+static_assert(sizeof(Header) == 16);
+
+// Free blocks are linked through their first word. Chunks are kept for the
+// life of the process: the driver may free into them until the very end.
+struct SizeClass {
+    std::mutex mutex;
+    void* free = nullptr;
+};
+static SizeClass size_classes[SIZE_CLASS_COUNT];
+
+// Bump allocator. Only the owning thread allocates; frees may come from
+// anywhere and just drop the live count.
+struct Arena {
+    char* base = nullptr;
+    size_t top = 0;
+    std::atomic<uint32_t> live{0};
+
+    ~Arena() {
+        if (base) ::operator delete(base, std::align_val_t(CHUNK_ALIGNMENT));
+    }
+};
+static thread_local Arena t_arena;
+
+struct ScopeCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> live_allocations{0};
+    std::atomic<uint64_t> live_bytes{0};
+    std::atomic<uint64_t> peak_bytes{0};
+    std::atomic<uint64_t> internal_bytes{0};
+};
+static ScopeCounters scope_counters[HOST_ALLOCATION_SCOPE_COUNT];
+static std::atomic<uint64_t> pooled_count{0};
+static std::atomic<uint64_t> arena_count{0};
+static std::atomic<uint64_t> large_count{0};
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void count_allocation(uint8_t scope, size_t size) {
+    ScopeCounters& counters = scope_counters[scope];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+    uint64_t live = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+static void count_free(uint8_t scope, size_t size) {
+    ScopeCounters& counters = scope_counters[scope];
+    counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    counters.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static char* pool_allocate(uint32_t index) {
+    SizeClass& sizeClass = size_classes[index];
+    size_t blockSize = MIN_CLASS << index;
+    std::lock_guard lock(sizeClass.mutex);
+    if (!sizeClass.free) {
+        char* chunk = static_cast<char*>(::operator new(CHUNK_SIZE, std::align_val_t(CHUNK_ALIGNMENT), std::nothrow));
+        if (!chunk) return nullptr;
+        for (size_t offset = CHUNK_SIZE; offset >= blockSize; offset -= blockSize) {
+            char* block = chunk + offset - blockSize;
+            *reinterpret_cast<void**>(block) = sizeClass.free;
+            sizeClass.free = block;
+        }
+    }
+    char* block = static_cast<char*>(sizeClass.free);
+    sizeClass.free = *reinterpret_cast<void**>(block);
+    return block;
+}
+
+static void pool_free(uint32_t index, char* block) {
+    SizeClass& sizeClass = size_classes[index];
+    std::lock_guard lock(sizeClass.mutex);
+    *reinterpret_cast<void**>(block) = sizeClass.free;
+    sizeClass.free = block;
+}
+
+static char* arena_allocate(size_t size, size_t alignment) {
+    Arena& arena = t_arena;
+    if (!arena.base) {
+        arena.base = static_cast<char*>(::operator new(ARENA_SIZE, std::align_val_t(CHUNK_ALIGNMENT), std::nothrow));
+        if (!arena.base) return nullptr;
+    }
+    // Everything from the previous commands is gone, start over.
+    if (arena.live.load(std::memory_order_acquire) == 0) arena.top = 0;
+    size_t offset = align_up(arena.top, alignment);
+    if (offset + size > ARENA_SIZE) return nullptr;
+    arena.top = offset + size;
+    arena.live.fetch_add(1, std::memory_order_relaxed);
+    return arena.base + offset;
+}
+
+static void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    // The header keeps 32-bit sizes and 16-bit padding; the driver gets
+    // VK_ERROR_OUT_OF_HOST_MEMORY for anything beyond.
+    size_t pad = std::max(alignment, sizeof(Header));
+    if (size > UINT32_MAX || pad > UINT16_MAX || !std::has_single_bit(alignment)) return nullptr;
+
+    char* block = nullptr;
+    void* owner = nullptr;
+    uint8_t kind;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && pad <= CHUNK_ALIGNMENT &&
+        (block = arena_allocate(pad + size, pad))) {
+        kind = KIND_ARENA;
+        owner = &t_arena;
+        arena_count.fetch_add(1, std::memory_order_relaxed);
+    } else if (pad + size <= MAX_CLASS) {
+        kind = static_cast<uint8_t>(std::countr_zero(std::bit_ceil(std::max(pad + size, MIN_CLASS)) / MIN_CLASS));
+        block = pool_allocate(kind);
+        pooled_count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        kind = KIND_LARGE;
+        block = static_cast<char*>(::operator new(pad + size, std::align_val_t(pad), std::nothrow));
+        large_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!block) return nullptr;
+
+    char* memory = block + pad;
+    Header* header = reinterpret_cast<Header*>(memory) - 1;
+    *header = {owner, static_cast<uint32_t>(size), static_cast<uint16_t>(pad), kind, static_cast<uint8_t>(scope)};
+    count_allocation(header->scope, size);
+    return memory;
+}
+
+static void release(void* memory) {
+    if (!memory) return;
+    Header* header = static_cast<Header*>(memory) - 1;
+    char* block = static_cast<char*>(memory) - header->pad;
+    count_free(header->scope, header->size);
+
+    if (header->kind == KIND_ARENA)
+        static_cast<Arena*>(header->arena)->live.fetch_sub(1, std::memory_order_release);
+    else if (header->kind == KIND_LARGE)
+        ::operator delete(block, std::align_val_t(header->pad));
+    else
+        pool_free(header->kind, block);
+}
+
+static void* VKAPI_CALL allocation_callback(void*, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    return allocate(size, alignment, scope);
+}
+
+static void* VKAPI_CALL reallocation_callback(void*, void* original, size_t size, size_t alignment,
+                                              VkSystemAllocationScope scope) {
+    if (!original) return allocate(size, alignment, scope);
+    if (size == 0) {
+        release(original);
+        return nullptr;
+    }
+
+    // Grow or shrink in place while it still fits the size class.
+    Header* header = static_cast<Header*>(original) - 1;
+    if (header->kind < SIZE_CLASS_COUNT && header->pad + size <= (MIN_CLASS << header->kind)) {
+        ScopeCounters& counters = scope_counters[header->scope];
+        counters.live_bytes.fetch_add(size - header->size, std::memory_order_relaxed);
+        header->size = static_cast<uint32_t>(size);
+        return original;
+    }
+
+    // On failure the original stays valid, as the spec requires.
+    void* moved = allocate(size, alignment, scope);
+    if (!moved) return nullptr;
+    std::memcpy(moved, original, std::min<size_t>(size, header->size));
+    release(original);
+    return moved;
+}
+
+static void VKAPI_CALL free_callback(void*, void* memory) {
+    release(memory);
+}
+
+static void VKAPI_CALL internal_allocation_callback(void*, size_t size, VkInternalAllocationType,
+                                                    VkSystemAllocationScope scope) {
+    scope_counters[scope].internal_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void VKAPI_CALL internal_free_callback(void*, size_t size, VkInternalAllocationType,
+                                              VkSystemAllocationScope scope) {
+    scope_counters[scope].internal_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static const VkAllocationCallbacks callbacks = {
+    nullptr,
+    allocation_callback,
+    reallocation_callback,
+    free_callback,
+    internal_allocation_callback,
+    internal_free_callback,
+};
+
+const VkAllocationCallbacks* host_allocator() {
+    return &callbacks;
+}
+
+const char* host_allocation_scope_name(VkSystemAllocationScope scope) {
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default: return "unknown";
+    }
+}
+
+HostAllocationStats host_allocation_stats() {
+    HostAllocationStats stats;
+    for (uint32_t i = 0; i < HOST_ALLOCATION_SCOPE_COUNT; i++) {
+        const ScopeCounters& counters = scope_counters[i];
+        stats.scopes[i].allocations = counters.allocations.load(std::memory_order_relaxed);
+        stats.scopes[i].live_allocations = counters.live_allocations.load(std::memory_order_relaxed);
+        stats.scopes[i].live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+        stats.scopes[i].peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+        stats.scopes[i].internal_bytes = counters.internal_bytes.load(std::memory_order_relaxed);
+    }
+    stats.pooled = pooled_count.load(std::memory_order_relaxed);
+    stats.arena = arena_count.load(std::memory_order_relaxed);
+    stats.large = large_count.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void host_allocation_counters() {
+#ifdef RUNE_PROFILE
+    // The profiler keeps the name pointers.
+    static const char* const BYTES_NAMES[HOST_ALLOCATION_SCOPE_COUNT] = {
+        "host: command (KiB)", "host: object (KiB)", "host: cache (KiB)", "host: device (KiB)", "host: instance (KiB)",
+    };
+    static uint64_t lastAllocations = 0;
+    static uint64_t lastCommand = 0;
+
+    HostAllocationStats stats = host_allocation_stats();
+    uint64_t allocations = 0;
+    for (uint32_t i = 0; i < HOST_ALLOCATION_SCOPE_COUNT; i++) {
+        PROFILE_COUNTER(BYTES_NAMES[i], stats.scopes[i].live_bytes / 1024.0);
+        allocations += stats.scopes[i].allocations;
+    }
+    PROFILE_COUNTER("host: allocations per frame", static_cast<double>(allocations - lastAllocations));
+    uint64_t command = stats.scopes[VK_SYSTEM_ALLOCATION_SCOPE_COMMAND].allocations;
+    PROFILE_COUNTER("host: command allocations per frame", static_cast<double>(command - lastCommand));
+    lastAllocations = allocations;
+    lastCommand = command;
+#endif
+}
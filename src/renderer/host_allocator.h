@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// Engine VkAllocationCallbacks for the driver's host allocations. Small
+// requests come from power-of-two size classes carved out of 64 KiB
+// chunks; COMMAND scope ones, which only live for the duration of the call
+// that made them, come from a per-thread scratch arena that rewinds once
+// everything in it has been freed; larger ones go to the system allocator.
+// Every allocation is counted per VkSystemAllocationScope, so driver malloc
+// pressure during recording shows up in the stats and the profiler.
+//
+// Pass host_allocator() as pAllocator everywhere: an object created with
+// callbacks has to be destroyed with them. Callable from any thread.
+const VkAllocationCallbacks* host_allocator();
+
+// Indexed by VkSystemAllocationScope.
+const uint32_t HOST_ALLOCATION_SCOPE_COUNT = 5;
+const char* host_allocation_scope_name(VkSystemAllocationScope scope);
+
+struct HostAllocationStats {
+    struct Scope {
+        uint64_t allocations = 0;
+        uint64_t live_allocations = 0;
+        uint64_t live_bytes = 0;
+        uint64_t peak_bytes = 0;
+        // Driver allocations it only reports through the internal
+        // notifications, e.g. executable memory.
+        uint64_t internal_bytes = 0;
+    };
+    Scope scopes[HOST_ALLOCATION_SCOPE_COUNT];
+    // Where allocations were served from, since startup.
+    uint64_t pooled = 0;
+    uint64_t arena = 0;
+    uint64_t large = 0;
+};
+HostAllocationStats host_allocation_stats();
+
+// Once per frame: publishes live bytes per scope and the allocations made
+// since the last call as profiler counters. No-op without RUNE_PROFILE.
+void host_allocation_counters();
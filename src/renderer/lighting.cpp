@@ -0,0 +1,165 @@
+#include "lighting.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const uint32_t BINNING_GROUP_SIZE = 64;
+    const VkShaderStageFlags LIGHTING_STAGES = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    void transform(const float m[16], const float in[3], float w, float out[3]) {
+        for (int i = 0; i < 3; i++)
+            out[i] = m[i] * in[0] + m[4 + i] * in[1] + m[8 + i] * in[2] + m[12 + i] * w;
+    }
+}
+
+void ClusteredLighting::init(VkPhysicalDevice physical_device, VkDevice device, VkExtent2D extent, uint32_t frame_count,
+                             const std::vector<char>& binning_code, DescriptorLayoutCache& layout_cache,
+                             PipelineLayoutCache& pipeline_layout_cache, MemoryBudget* budget) {
+    m_device = device;
+    m_extent = extent;
+    m_grid[0] = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+    m_grid[1] = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+    m_grid[2] = DEPTH_SLICES;
+
+    m_layout = layout_cache.get({
+        {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, LIGHTING_STAGES, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, LIGHTING_STAGES, nullptr},
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, LIGHTING_STAGES, nullptr},
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, LIGHTING_STAGES, nullptr},
+    });
+    m_pipeline_layout = pipeline_layout_cache.get({m_layout}, {});
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = binning_code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(binning_code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &moduleInfo, host_allocator(), &module) != VK_SUCCESS)
+        throw std::runtime_error("failed to create light binning shader module!");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipeline_layout;
+
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, host_allocator(), &m_pipeline);
+    vkDestroyShaderModule(device, module, host_allocator());
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to create light binning pipeline!");
+
+    const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkDeviceSize gridSize = sizeof(uint32_t) * 2 * cluster_count();
+    VkDeviceSize indexSize = sizeof(uint32_t) * (1 + cluster_count() * AVERAGE_LIGHTS_PER_CLUSTER);
+
+    m_frames.resize(frame_count);
+    for (Frame& frame : m_frames) {
+        for (VulkanBuffer* buffer : {&frame.params, &frame.lights, &frame.grid, &frame.indices})
+            buffer->track(budget, MemoryCategory::OTHER);
+        bool ok = frame.params.init(physical_device, device, sizeof(Params), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible) &&
+                  frame.lights.init(physical_device, device, sizeof(GpuLight) * MAX_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible) &&
+                  frame.grid.init(physical_device, device, gridSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+                  frame.indices.init(physical_device, device, indexSize,
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (!ok) throw std::runtime_error("failed to create lighting buffers!");
+
+        vkMapMemory(device, frame.params.m_memory, 0, VK_WHOLE_SIZE, 0, &frame.mapped_params);
+        vkMapMemory(device, frame.lights.m_memory, 0, VK_WHOLE_SIZE, 0, &frame.mapped_lights);
+    }
+}
+
+// The set and pipeline layouts belong to the caches.
+void ClusteredLighting::deinit(VkDevice device) {
+    for (Frame& frame : m_frames) {
+        frame.params.deinit(device);
+        frame.lights.deinit(device);
+        frame.grid.deinit(device);
+        frame.indices.deinit(device);
+    }
+    m_frames.clear();
+    if (m_pipeline) vkDestroyPipeline(device, m_pipeline, host_allocator());
+    m_pipeline = VK_NULL_HANDLE;
+}
+
+void ClusteredLighting::set_view(const float view[16], float proj_x, float proj_y, float near_plane, float far_plane) {
+    std::memcpy(m_view, view, sizeof(m_view));
+    m_proj[0] = proj_x;
+    m_proj[1] = proj_y;
+    m_proj[2] = near_plane;
+    m_proj[3] = far_plane;
+}
+
+void ClusteredLighting::record(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet set) {
+    Frame& frame = m_frames[frame_index];
+    frame.set = set;
+    VkDescriptorBufferInfo bufferInfos[4] = {
+        {frame.params.get_buffer(), 0, VK_WHOLE_SIZE},
+        {frame.lights.get_buffer(), 0, VK_WHOLE_SIZE},
+        {frame.grid.get_buffer(), 0, VK_WHOLE_SIZE},
+        {frame.indices.get_buffer(), 0, VK_WHOLE_SIZE},
+    };
+    VkWriteDescriptorSet writes[4]{};
+    for (uint32_t i = 0; i < 4; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+
+    uint32_t count = static_cast<uint32_t>(std::min<size_t>(lights.size(), MAX_LIGHTS));
+    GpuLight* mapped = static_cast<GpuLight*>(frame.mapped_lights);
+    for (uint32_t i = 0; i < count; i++) {
+        mapped[i] = lights[i];
+        transform(m_view, lights[i].position, 1.0f, mapped[i].position);
+        transform(m_view, lights[i].direction, 0.0f, mapped[i].direction);
+    }
+
+    Params params;
+    std::memcpy(params.view, m_view, sizeof(params.view));
+    std::memcpy(params.proj, m_proj, sizeof(params.proj));
+    params.grid[0] = m_grid[0];
+    params.grid[1] = m_grid[1];
+    params.grid[2] = m_grid[2];
+    params.grid[3] = count;
+    params.screen[0] = static_cast<float>(m_extent.width);
+    params.screen[1] = static_cast<float>(m_extent.height);
+    params.screen[2] = static_cast<float>(TILE_SIZE);
+    params.screen[3] = DEPTH_SLICES / std::log(m_proj[3] / m_proj[2]);
+    std::memcpy(frame.mapped_params, &params, sizeof(params));
+
+    // The index list counter starts from zero every frame.
+    vkCmdFillBuffer(command_buffer, frame.indices.get_buffer(), 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &frame.set, 0, nullptr);
+    vkCmdDispatch(command_buffer, (cluster_count() + BINNING_GROUP_SIZE - 1) / BINNING_GROUP_SIZE, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void ClusteredLighting::bind(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t frame) const {
+    if (!enabled()) return;
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, SET, 1, &m_frames[frame].set, 0, nullptr);
+}
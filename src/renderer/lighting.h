@@ -0,0 +1,111 @@
+#pragma once
+
+#include "buffer.h"
+#include "descriptors.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+enum LightType : uint32_t {
+    LIGHT_POINT = 0,
+    LIGHT_SPOT = 1,
+};
+
+// One light, std430; matches `Light` in assets/shaders/clustered.glsl.
+// Filled in world space, uploaded in view space.
+struct GpuLight {
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float range = 1.0f;
+    float color[3] = {1.0f, 1.0f, 1.0f};
+    float intensity = 1.0f;
+    // Spot lights only: cone axis and cosines of the cone half-angles.
+    float direction[3] = {0.0f, 0.0f, -1.0f};
+    float spot_outer_cos = 0.0f;
+    float spot_inner_cos = 0.0f;
+    uint32_t type = LIGHT_POINT;
+    uint32_t pad[2] = {0, 0};
+};
+
+static_assert(sizeof(GpuLight) == 64, "GpuLight must match the std430 Light struct");
+
+// Clustered forward lighting. The view frustum is cut into a froxel grid of
+// TILE_SIZE pixel tiles times DEPTH_SLICES exponential depth slices; each
+// frame a compute pass (assets/shaders/cluster_lights.comp) tests every
+// light's bounding sphere against every froxel and writes a compact light
+// index list per cluster. Fragment shaders include clustered.glsl and loop
+// only over their cluster's lights, so shading cost follows local light
+// density instead of the total light count.
+//
+// Everything written per frame is per frame in flight, so binning frame N+1
+// never waits on frame N's fragment shaders.
+struct ClusteredLighting {
+    static const uint32_t TILE_SIZE = 64;
+    static const uint32_t DEPTH_SLICES = 24;
+    static const uint32_t MAX_LIGHTS = 16384;
+    // Capacity of the shared index list, per cluster on average. Clusters
+    // binned after it runs out get no lights.
+    static const uint32_t AVERAGE_LIGHTS_PER_CLUSTER = 32;
+    // Set index the lighting set is bound at in graphics pipeline layouts.
+    static const uint32_t SET = 1;
+
+    // `binning_code` is cluster_lights.comp.spv. The frame buffers are
+    // tracked in `budget` as OTHER when given.
+    void init(VkPhysicalDevice physical_device, VkDevice device, VkExtent2D extent, uint32_t frame_count,
+              const std::vector<char>& binning_code, DescriptorLayoutCache& layout_cache,
+              PipelineLayoutCache& pipeline_layout_cache, MemoryBudget* budget = nullptr);
+    void deinit(VkDevice device);
+
+    // Column-major world-to-view matrix (right-handed, looking down -Z) and
+    // the projection's x/y scale (P[0][0], P[1][1]) and clip planes.
+    void set_view(const float view[16], float proj_x, float proj_y, float near_plane, float far_plane);
+
+    // Uploads `lights` and the view for `frame`, then records the binning
+    // dispatch and the barrier that hands its results to fragment shaders.
+    // Must be recorded outside a render pass. `set` is a fresh set of
+    // layout() that lives for the frame (Renderer::allocate_frame_set());
+    // it is written here and bound by bind() until the next record().
+    void record(VkCommandBuffer command_buffer, uint32_t frame, VkDescriptorSet set);
+    void bind(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t frame) const;
+
+    bool enabled() const { return m_pipeline != VK_NULL_HANDLE; }
+    VkDescriptorSetLayout layout() const { return m_layout; }
+    uint32_t cluster_count() const { return m_grid[0] * m_grid[1] * m_grid[2]; }
+
+    // Set every frame by the application; lights past MAX_LIGHTS are ignored.
+    std::vector<GpuLight> lights;
+
+    private:
+    // std140; matches `ClusterParams` in clustered.glsl.
+    struct Params {
+        float view[16];
+        // proj_x, proj_y, near, far
+        float proj[4];
+        // grid x, y, z, light count
+        uint32_t grid[4];
+        // width, height, tile size, slices / log(far / near)
+        float screen[4];
+    };
+
+    struct Frame {
+        VulkanBuffer params;
+        VulkanBuffer lights;
+        // uvec2(offset, count) per cluster
+        VulkanBuffer grid;
+        // uint counter, then the indices
+        VulkanBuffer indices;
+        void* mapped_params = nullptr;
+        void* mapped_lights = nullptr;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames;
+    uint32_t m_grid[3] = {0, 0, 0};
+    VkExtent2D m_extent{};
+    float m_view[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    float m_proj[4] = {1.0f, 1.0f, 0.1f, 100.0f};
+};
@@ -0,0 +1,132 @@
+#include "memory_budget.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+const char* memory_category_name(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::MESHES: return "meshes";
+        case MemoryCategory::TEXTURES: return "textures";
+        case MemoryCategory::STAGING: return "staging";
+        case MemoryCategory::TRANSIENT: return "transient";
+        case MemoryCategory::OTHER: return "other";
+    }
+    return "unknown";
+}
+
+void MemoryBudget::init(VkPhysicalDevice physical_device, bool extension) {
+    m_physical_device = physical_device;
+    m_extension = extension;
+
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+    m_heap_count = properties.memoryHeapCount;
+    for (uint32_t i = 0; i < properties.memoryTypeCount; i++) m_heap_of[i] = properties.memoryTypes[i].heapIndex;
+    for (uint32_t i = 0; i < m_heap_count; i++) {
+        m_heaps[i] = {};
+        m_heaps[i].size = properties.memoryHeaps[i].size;
+        m_heaps[i].device_local = properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+    if (!extension) std::cout << "Memory budget extension not available, budgets are estimated\n";
+    update();
+}
+
+void MemoryBudget::track_heap(uint32_t memory_type, int64_t bytes) {
+    m_tracked[m_heap_of[memory_type]].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void MemoryBudget::track_category(MemoryCategory category, int64_t bytes) {
+    m_categories[static_cast<uint32_t>(category)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+MemoryBudget::Heap MemoryBudget::heap(uint32_t index) const {
+    Heap heap = m_heaps[index];
+    heap.tracked = static_cast<VkDeviceSize>(std::max<int64_t>(m_tracked[index].load(std::memory_order_relaxed), 0));
+    return heap;
+}
+
+VkDeviceSize MemoryBudget::category_bytes(MemoryCategory category) const {
+    int64_t bytes = m_categories[static_cast<uint32_t>(category)].load(std::memory_order_relaxed);
+    return static_cast<VkDeviceSize>(std::max<int64_t>(bytes, 0));
+}
+
+VkDeviceSize MemoryBudget::relieve(uint32_t heap, VkDeviceSize excess) {
+    m_pressure_events++;
+    m_cooldown = COOLDOWN_FRAMES;
+    VkDeviceSize released = 0;
+    for (PressureHook& hook : m_hooks) {
+        if (released >= excess) break;
+        released += hook(heap, excess - released);
+    }
+    return released;
+}
+
+bool MemoryBudget::reserve(uint32_t memory_type, VkDeviceSize size) {
+    uint32_t index = m_heap_of[memory_type];
+    Heap current = heap(index);
+    // Driver usage lags what was allocated since the last update.
+    VkDeviceSize usage = std::max(current.usage, current.tracked) + size;
+    VkDeviceSize limit = static_cast<VkDeviceSize>(current.budget * PRESSURE);
+    if (usage <= limit) return true;
+    if (m_cooldown == 0) relieve(index, usage - limit);
+    return usage <= current.budget;
+}
+
+void MemoryBudget::update() {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (m_extension) {
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2(m_physical_device, &properties);
+    }
+
+    for (uint32_t i = 0; i < m_heap_count; i++) {
+        Heap& heap = m_heaps[i];
+        VkDeviceSize tracked = this->heap(i).tracked;
+        if (m_extension && budget.heapBudget[i] > 0) {
+            heap.budget = std::min(budget.heapBudget[i], heap.size);
+            heap.usage = budget.heapUsage[i];
+        } else {
+            heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET);
+            heap.usage = tracked;
+        }
+    }
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+    } else {
+        for (uint32_t i = 0; i < m_heap_count; i++) {
+            VkDeviceSize limit = static_cast<VkDeviceSize>(m_heaps[i].budget * PRESSURE);
+            if (m_heaps[i].usage > limit) {
+                relieve(i, m_heaps[i].usage - limit);
+                break;
+            }
+        }
+    }
+
+#ifdef RUNE_PROFILE
+    const double MIB = 1024.0 * 1024.0;
+    Stats totals = stats();
+    PROFILE_COUNTER("vram usage (MiB)", totals.device_local_usage / MIB);
+    PROFILE_COUNTER("vram budget (MiB)", totals.device_local_budget / MIB);
+    PROFILE_COUNTER("memory: meshes (MiB)", category_bytes(MemoryCategory::MESHES) / MIB);
+    PROFILE_COUNTER("memory: textures (MiB)", category_bytes(MemoryCategory::TEXTURES) / MIB);
+    PROFILE_COUNTER("memory: staging (MiB)", category_bytes(MemoryCategory::STAGING) / MIB);
+    PROFILE_COUNTER("memory: transient (MiB)", category_bytes(MemoryCategory::TRANSIENT) / MIB);
+    PROFILE_COUNTER("memory: other (MiB)", category_bytes(MemoryCategory::OTHER) / MIB);
+#endif
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const {
+    Stats stats;
+    for (uint32_t i = 0; i < m_heap_count; i++) {
+        if (!m_heaps[i].device_local) continue;
+        stats.device_local_usage += m_heaps[i].usage;
+        stats.device_local_budget += m_heaps[i].budget;
+    }
+    stats.pressure_events = m_pressure_events;
+    return stats;
+}
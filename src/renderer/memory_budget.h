@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum class MemoryCategory : uint32_t {
+    MESHES,
+    TEXTURES,
+    STAGING,
+    // Render targets and render graph images.
+    TRANSIENT,
+    OTHER,
+};
+
+const uint32_t MEMORY_CATEGORY_COUNT = 5;
+const char* memory_category_name(MemoryCategory category);
+
+// Device memory accounting. Every allocation the engine makes reports its
+// memory type, size and category: heap bytes count actual VkDeviceMemory,
+// category bytes count what was asked for, so suballocators report blocks
+// to the heap and their allocations to a category.
+//
+// update() reads each heap's usage and budget from VK_EXT_memory_budget
+// when the device has it (usage then includes what the driver allocated
+// on our behalf); otherwise usage is our own count and the budget a fixed
+// fraction of the heap. When usage in a heap crosses PRESSURE of its
+// budget, the pressure hooks run in registration order until they have
+// released the excess, so systems can evict or drop to lower quality
+// before the driver starts paging or allocations fail.
+struct MemoryBudget {
+    // Fraction of a heap's budget at which the pressure hooks run.
+    static constexpr double PRESSURE = 0.9;
+    // Budget as a fraction of the heap size without VK_EXT_memory_budget.
+    static constexpr double FALLBACK_BUDGET = 0.8;
+    // Frees are deferred by frames in flight, so after the hooks ran the
+    // usage is left to settle for this many updates.
+    static const uint32_t COOLDOWN_FRAMES = 4;
+
+    // Gets the heap that is over, and how many bytes it is over by; returns
+    // how many bytes it will release.
+    using PressureHook = std::function<VkDeviceSize(uint32_t heap, VkDeviceSize excess)>;
+
+    // `extension` when VK_EXT_memory_budget was enabled on the device.
+    void init(VkPhysicalDevice physical_device, bool extension);
+
+    void track_heap(uint32_t memory_type, int64_t bytes);
+    void track_category(MemoryCategory category, int64_t bytes);
+    void track(uint32_t memory_type, MemoryCategory category, int64_t bytes) {
+        track_heap(memory_type, bytes);
+        track_category(category, bytes);
+    }
+
+    // Call before allocating `size` bytes of `memory_type`: runs the
+    // pressure hooks early when the allocation would cross the threshold.
+    // Returns whether it still fits the budget afterwards.
+    bool reserve(uint32_t memory_type, VkDeviceSize size);
+    // Once per frame: refreshes usage and budgets, runs the pressure hooks
+    // and publishes the profiler counters.
+    void update();
+    void on_pressure(PressureHook hook) { m_hooks.push_back(std::move(hook)); }
+
+    struct Heap {
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        // Bytes the engine allocated itself.
+        VkDeviceSize tracked = 0;
+        bool device_local = false;
+    };
+    uint32_t heap_count() const { return m_heap_count; }
+    Heap heap(uint32_t index) const;
+    uint32_t heap_of(uint32_t memory_type) const { return m_heap_of[memory_type]; }
+    VkDeviceSize category_bytes(MemoryCategory category) const;
+
+    struct Stats {
+        VkDeviceSize device_local_usage = 0;
+        VkDeviceSize device_local_budget = 0;
+        uint32_t pressure_events = 0;
+    };
+    Stats stats() const;
+
+    private:
+    VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+    bool m_extension = false;
+    uint32_t m_heap_count = 0;
+    uint32_t m_heap_of[VK_MAX_MEMORY_TYPES] = {};
+    Heap m_heaps[VK_MAX_MEMORY_HEAPS];
+    // Allocations may come from workers; everything else is render thread.
+    std::atomic<int64_t> m_tracked[VK_MAX_MEMORY_HEAPS] = {};
+    std::atomic<int64_t> m_categories[MEMORY_CATEGORY_COUNT] = {};
+    std::vector<PressureHook> m_hooks;
+    uint32_t m_cooldown = 0;
+    uint32_t m_pressure_events = 0;
+
+    VkDeviceSize relieve(uint32_t heap, VkDeviceSize excess);
+};
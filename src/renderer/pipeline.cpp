@@ -1,22 +1,27 @@
 #include "pipeline.h"
+#include "host_allocator.h"
+#include "spirv_reflect.h"
 #include "../utils/file.h"
 
 #include <stdexcept>
 
-Pipeline::Pipeline(Device& device, const std::string& vert_path, const std::string& frag_path, PipelineConfigInfo config) : m_vert_path(vert_path), m_frag_path(frag_path), m_device(device) {
+Pipeline::Pipeline(Device& device, const std::string& vert_path, const std::string& frag_path, PipelineConfigInfo config) : m_vert_path(vert_path), m_frag_path(frag_path), m_device(device),
+      m_pipeline_layout(config.pipeline_layout), m_push_constant_ranges(config.push_constant_ranges) {
     create_graphics_pipeline();
 }
 
 Pipeline::~Pipeline() {
-    vkDestroyShaderModule(m_device.device(), m_vert_shader_module, nullptr);
-    vkDestroyShaderModule(m_device.device(), m_frag_shader_module, nullptr);
-    vkDestroyPipeline(m_device.device(), m_graphics_pipeline, nullptr);
+    vkDestroyShaderModule(m_device.device(), m_vert_shader_module, host_allocator());
+    vkDestroyShaderModule(m_device.device(), m_frag_shader_module, host_allocator());
+    vkDestroyPipeline(m_device.device(), m_graphics_pipeline, host_allocator());
 }
 
 void Pipeline::create_graphics_pipeline() {
     auto vert_code = read_file(m_vert_path);
     auto frag_code = read_file(m_frag_path);
-    
+    check_push_constants(reflect_spirv(vert_code), m_push_constant_ranges);
+    check_push_constants(reflect_spirv(frag_code), m_push_constant_ranges);
+
     create_shader_module(vert_code, &m_vert_shader_module);
     VkPipelineShaderStageCreateInfo vert_stage{};
     vert_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -40,7 +45,7 @@ void Pipeline::create_shader_module(const std::vector<char>& code, VkShaderModul
     create_info.codeSize = code.size();
     create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-    if (vkCreateShaderModule(m_device.device(), &create_info, nullptr, shader_module) != VK_SUCCESS) {
+    if (vkCreateShaderModule(m_device.device(), &create_info, host_allocator(), shader_module) != VK_SUCCESS) {
         throw std::runtime_error("failed to create shader module");
     }
 }
@@ -51,4 +56,13 @@ void Pipeline::default_config_info(PipelineConfigInfo config_info) {
 
 void Pipeline::bind(VkCommandBuffer command_buffer) {
     vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
-}
\ No newline at end of file
+}
+
+void Pipeline::retire(DeletionQueue& queue, uint64_t value) {
+    queue.retire(value, m_graphics_pipeline);
+    queue.retire(value, m_vert_shader_module);
+    queue.retire(value, m_frag_shader_module);
+    m_graphics_pipeline = VK_NULL_HANDLE;
+    m_vert_shader_module = VK_NULL_HANDLE;
+    m_frag_shader_module = VK_NULL_HANDLE;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "device.h"
+#include "deletion_queue.h"
+#include "push_constants.h"
 
 #include <string>
 #include <vector>
@@ -22,6 +24,9 @@ struct PipelineConfigInfo {
     VkPipelineDepthStencilStateCreateInfo depth_stencil_info;
     std::vector<VkDynamicState> dynamic_state_enables;
     VkPipelineDynamicStateCreateInfo dynamics_state_info;
+    // Must match the ranges pipeline_layout was created with; shaders are
+    // checked against them when the pipeline is built.
+    std::vector<VkPushConstantRange> push_constant_ranges{};
     VkPipelineLayout pipeline_layout = nullptr;
     VkRenderPass renderpass = nullptr;
     uint32_t subpass = 0;
@@ -38,10 +43,19 @@ struct Pipeline {
     void create_shader_module(const std::vector<char>& code, VkShaderModule* shader_module);
     void default_config_info(PipelineConfigInfo config_info);
     void bind(VkCommandBuffer command_buffer);
+    template <typename T>
+    void push(VkCommandBuffer command_buffer, VkShaderStageFlags stages, const T& data, uint32_t offset = 0) {
+        push_constants(command_buffer, m_pipeline_layout, stages, data, offset);
+    }
+    // Hands the Vulkan objects to `queue` until `value` completes; the
+    // destructor then has nothing left to destroy.
+    void retire(DeletionQueue& queue, uint64_t value);
     
     private:
     Device& m_device;
     VkPipeline m_graphics_pipeline;
+    VkPipelineLayout m_pipeline_layout;
+    std::vector<VkPushConstantRange> m_push_constant_ranges;
     VkShaderModule m_vert_shader_module;
     VkShaderModule m_frag_shader_module;
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <type_traits>
+
+// Every device supports at least this many bytes of push constants.
+const uint32_t MAX_PUSH_CONSTANT_BYTES = 128;
+
+// Pushes a per-draw struct (object index, material index, a small
+// transform). The cheapest per-draw path there is: no buffer write and no
+// descriptor update. `stages` must match the layout's range exactly.
+template <typename T>
+void push_constants(VkCommandBuffer command_buffer, VkPipelineLayout layout, VkShaderStageFlags stages,
+                    const T& data, uint32_t offset = 0) {
+    static_assert(std::is_trivially_copyable_v<T>, "push constants are copied as raw bytes");
+    static_assert(sizeof(T) % 4 == 0, "push constant size must be a multiple of 4");
+    static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_BYTES, "push constants larger than the guaranteed 128 bytes");
+    vkCmdPushConstants(command_buffer, layout, stages, offset, sizeof(T), &data);
+}
+
+// The matching range for a pipeline layout.
+template <typename T>
+VkPushConstantRange push_constant_range(VkShaderStageFlags stages, uint32_t offset = 0) {
+    static_assert(sizeof(T) % 4 == 0 && sizeof(T) <= MAX_PUSH_CONSTANT_BYTES);
+    return {stages, offset, static_cast<uint32_t>(sizeof(T))};
+}
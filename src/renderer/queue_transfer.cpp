@@ -0,0 +1,73 @@
+#include "queue_transfer.h"
+
+// Release: the source queue finishes its writes; dstStage/dstAccess are
+// ignored by the spec for the releasing barrier.
+// Acquire: srcStage/srcAccess are ignored; the semaphore wait orders it.
+
+static VkBufferMemoryBarrier buffer_barrier(VkBuffer buffer, const QueueTransfer& transfer) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = transfer.same_family() ? VK_QUEUE_FAMILY_IGNORED : transfer.src_family;
+    barrier.dstQueueFamilyIndex = transfer.same_family() ? VK_QUEUE_FAMILY_IGNORED : transfer.dst_family;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    return barrier;
+}
+
+static VkImageMemoryBarrier image_barrier(VkImage image, const VkImageSubresourceRange& range,
+                                          VkImageLayout old_layout, VkImageLayout new_layout,
+                                          const QueueTransfer& transfer) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = transfer.same_family() ? VK_QUEUE_FAMILY_IGNORED : transfer.src_family;
+    barrier.dstQueueFamilyIndex = transfer.same_family() ? VK_QUEUE_FAMILY_IGNORED : transfer.dst_family;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    return barrier;
+}
+
+void release_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const QueueTransfer& transfer) {
+    if (transfer.same_family()) return;
+
+    VkBufferMemoryBarrier barrier = buffer_barrier(buffer, transfer);
+    barrier.srcAccessMask = transfer.src_access;
+    vkCmdPipelineBarrier(command_buffer, transfer.src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void acquire_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const QueueTransfer& transfer) {
+    // Same family: the semaphore already made the writes available and
+    // visible, and a buffer has no layout to change.
+    if (transfer.same_family()) return;
+
+    VkBufferMemoryBarrier barrier = buffer_barrier(buffer, transfer);
+    barrier.dstAccessMask = transfer.dst_access;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, transfer.dst_stage, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void release_image(VkCommandBuffer command_buffer, VkImage image, const VkImageSubresourceRange& range,
+                   VkImageLayout old_layout, VkImageLayout new_layout, const QueueTransfer& transfer) {
+    if (transfer.same_family()) return;
+
+    VkImageMemoryBarrier barrier = image_barrier(image, range, old_layout, new_layout, transfer);
+    barrier.srcAccessMask = transfer.src_access;
+    vkCmdPipelineBarrier(command_buffer, transfer.src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void acquire_image(VkCommandBuffer command_buffer, VkImage image, const VkImageSubresourceRange& range,
+                   VkImageLayout old_layout, VkImageLayout new_layout, const QueueTransfer& transfer) {
+    if (transfer.same_family() && old_layout == new_layout) return;
+
+    VkImageMemoryBarrier barrier = image_barrier(image, range, old_layout, new_layout, transfer);
+    barrier.dstAccessMask = transfer.dst_access;
+    // Same family: the layout change happens here, chained to the semaphore
+    // wait through dst_stage.
+    VkPipelineStageFlags src_stage = transfer.same_family() ? transfer.dst_stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(command_buffer, src_stage, transfer.dst_stage, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// Moves an EXCLUSIVE buffer or image between queue families (graphics <->
+// async compute <-> transfer). The release half is recorded on the source
+// queue, the acquire half on the destination queue in a submit that waits
+// on the source's timeline; both halves must be given the same transfer.
+//
+// When the families match nothing changes hands: release records nothing and
+// acquire is a plain barrier (still needed for layout changes). dst_stage
+// must be covered by the semaphore wait's stage mask so the two chain.
+struct QueueTransfer {
+    uint32_t src_family;
+    uint32_t dst_family;
+    VkPipelineStageFlags src_stage;
+    VkAccessFlags src_access;
+    VkPipelineStageFlags dst_stage;
+    VkAccessFlags dst_access;
+
+    bool same_family() const { return src_family == dst_family; }
+};
+
+void release_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const QueueTransfer& transfer);
+void acquire_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const QueueTransfer& transfer);
+
+void release_image(VkCommandBuffer command_buffer, VkImage image, const VkImageSubresourceRange& range,
+                   VkImageLayout old_layout, VkImageLayout new_layout, const QueueTransfer& transfer);
+void acquire_image(VkCommandBuffer command_buffer, VkImage image, const VkImageSubresourceRange& range,
+                   VkImageLayout old_layout, VkImageLayout new_layout, const QueueTransfer& transfer);
@@ -0,0 +1,456 @@
+#include "render_graph.h"
+#include "host_allocator.h"
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    struct UsageInfo {
+        VkImageLayout layout;
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        bool write;
+        VkImageUsageFlags image_usage;
+    };
+
+    const VkPipelineStageFlags SHADER_STAGES = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    const VkPipelineStageFlags DEPTH_STAGES = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    UsageInfo usage_info(RGUsage usage) {
+        switch (usage) {
+            case RGUsage::COLOR_ATTACHMENT:
+                return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+            case RGUsage::DEPTH_ATTACHMENT:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, DEPTH_STAGES,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true,
+                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+            case RGUsage::DEPTH_READ:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, DEPTH_STAGES | SHADER_STAGES,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, false,
+                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+            case RGUsage::SAMPLED:
+                return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT, false,
+                        VK_IMAGE_USAGE_SAMPLED_BIT};
+            case RGUsage::STORAGE_READ:
+                return {VK_IMAGE_LAYOUT_GENERAL, SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT, false,
+                        VK_IMAGE_USAGE_STORAGE_BIT};
+            case RGUsage::STORAGE_WRITE:
+                return {VK_IMAGE_LAYOUT_GENERAL, SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true,
+                        VK_IMAGE_USAGE_STORAGE_BIT};
+            case RGUsage::TRANSFER_SRC:
+                return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false,
+                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+            case RGUsage::TRANSFER_DST:
+                return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, true,
+                        VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+        }
+        throw std::runtime_error("unknown render graph usage!");
+    }
+
+    bool is_write(RGUsage usage) { return usage_info(usage).write; }
+}
+
+// ---------------- building ----------------
+RGResource RenderGraph::import_image(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+                                     VkImageAspectFlags aspect, VkImageLayout initial_layout, VkImageLayout final_layout) {
+    Resource resource{name, true, image, view, format, extent, aspect};
+    resource.initial_layout = initial_layout;
+    resource.final_layout = final_layout;
+    m_resources.push_back(resource);
+    m_compiled = false;
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::update_import(RGResource resource, VkImage image, VkImageView view) {
+    m_resources[resource].image = image;
+    m_resources[resource].view = view;
+}
+
+RGResource RenderGraph::create_image(const char* name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect) {
+    m_resources.push_back({name, false, VK_NULL_HANDLE, VK_NULL_HANDLE, format, extent, aspect});
+    m_compiled = false;
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::export_image(RGResource resource, VkImageLayout final_layout) {
+    m_resources[resource].final_layout = final_layout;
+    m_compiled = false;
+}
+
+RGPass RenderGraph::add_pass(const char* name, std::function<void(VkCommandBuffer)> execute) {
+    m_passes.push_back({name, std::move(execute)});
+    m_compiled = false;
+    return static_cast<RGPass>(m_passes.size() - 1);
+}
+
+void RenderGraph::use(RGPass pass, RGResource resource, RGUsage usage) {
+    m_passes[pass].uses.push_back({resource, usage});
+    m_compiled = false;
+}
+
+void RenderGraph::keep(RGPass pass) {
+    m_passes[pass].side_effect = true;
+    m_compiled = false;
+}
+
+// ---------------- compile ----------------
+// Walks the passes backwards from the outputs: a pass is live if it has
+// side effects or writes something a live pass or an output needs.
+void RenderGraph::cull() {
+    std::vector<bool> needed(m_resources.size(), false);
+    for (size_t i = 0; i < m_resources.size(); i++)
+        needed[i] = m_resources[i].final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+    for (size_t p = m_passes.size(); p-- > 0;) {
+        Pass& pass = m_passes[p];
+        pass.live = pass.side_effect;
+        for (const Use& use : pass.uses)
+            if (is_write(use.usage) && needed[use.resource]) pass.live = true;
+        if (!pass.live) continue;
+        for (const Use& use : pass.uses)
+            if (!is_write(use.usage)) needed[use.resource] = true;
+    }
+}
+
+// Orders the live passes by their read/write dependencies. Each use
+// depends on the last write of the resource declared before it, and a
+// write also on the reads since that write. Among ready passes the one
+// whose newest dependency was scheduled last goes first, so consumers run
+// right after their producers and transient lifetimes stay short; ties go
+// to declaration order. Kept passes may touch things the graph cannot see,
+// so they also stay in declaration order among themselves.
+void RenderGraph::sort() {
+    std::vector<std::vector<RGPass>> dependents(m_passes.size());
+    std::vector<uint32_t> pending(m_passes.size(), 0);
+    std::vector<RGPass> last_write(m_resources.size(), UINT32_MAX);
+    std::vector<std::vector<RGPass>> reads(m_resources.size());
+    RGPass last_kept = UINT32_MAX;
+
+    auto depend = [&](RGPass pass, RGPass on) {
+        if (on == UINT32_MAX || on == pass) return;
+        std::vector<RGPass>& edges = dependents[on];
+        if (std::find(edges.begin(), edges.end(), pass) != edges.end()) return;
+        edges.push_back(pass);
+        pending[pass]++;
+    };
+    for (RGPass p = 0; p < m_passes.size(); p++) {
+        if (!m_passes[p].live) continue;
+        if (m_passes[p].side_effect) {
+            depend(p, last_kept);
+            last_kept = p;
+        }
+        for (const Use& use : m_passes[p].uses) {
+            depend(p, last_write[use.resource]);
+            if (!is_write(use.usage)) continue;
+            for (RGPass reader : reads[use.resource]) depend(p, reader);
+        }
+        for (const Use& use : m_passes[p].uses) {
+            if (is_write(use.usage)) {
+                last_write[use.resource] = p;
+                reads[use.resource].clear();
+            } else {
+                reads[use.resource].push_back(p);
+            }
+        }
+    }
+
+    // Position of each pass's newest scheduled dependency, plus one.
+    std::vector<uint32_t> ready_after(m_passes.size(), 0);
+    std::vector<RGPass> ready;
+    for (RGPass p = 0; p < m_passes.size(); p++)
+        if (m_passes[p].live && pending[p] == 0) ready.push_back(p);
+
+    m_order.clear();
+    while (!ready.empty()) {
+        auto next = std::min_element(ready.begin(), ready.end(), [&](RGPass a, RGPass b) {
+            return ready_after[a] != ready_after[b] ? ready_after[a] > ready_after[b] : a < b;
+        });
+        RGPass pass = *next;
+        ready.erase(next);
+        m_order.push_back(pass);
+        for (RGPass dependent : dependents[pass]) {
+            ready_after[dependent] = static_cast<uint32_t>(m_order.size());
+            if (--pending[dependent] == 0) ready.push_back(dependent);
+        }
+    }
+}
+
+void RenderGraph::compile(VkPhysicalDevice physical_device, VkDevice device, DeletionQueue* retired, uint64_t value) {
+    release(device, retired, value);
+
+    cull();
+    sort();
+
+    m_stats = {};
+    for (Resource& resource : m_resources) {
+        resource.first_pass = UINT32_MAX;
+        resource.last_pass = 0;
+        resource.usage = 0;
+        resource.alias_of = UINT32_MAX;
+    }
+    m_stats.passes = static_cast<uint32_t>(m_order.size());
+    m_stats.culled_passes = static_cast<uint32_t>(m_passes.size() - m_order.size());
+    for (uint32_t i = 0; i < m_order.size(); i++) {
+        for (const Use& use : m_passes[m_order[i]].uses) {
+            Resource& resource = m_resources[use.resource];
+            resource.first_pass = std::min(resource.first_pass, i);
+            resource.last_pass = std::max(resource.last_pass, i);
+            resource.usage |= usage_info(use.usage).image_usage;
+        }
+    }
+    // Exported transients live until the end of the frame.
+    for (Resource& resource : m_resources)
+        if (!resource.imported && resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED && resource.first_pass != UINT32_MAX)
+            resource.last_pass = static_cast<uint32_t>(m_order.size());
+
+    allocate_transients(physical_device, device);
+    m_states.assign(m_resources.size(), {VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, false});
+    m_compiled = true;
+}
+
+// Greedy interval packing: biggest images first, each into the first
+// memory block whose occupants are all dead before it starts or born after
+// it ends. Aliased images need no create flag since they are never live at
+// the same time; the first barrier of each discards the old contents.
+void RenderGraph::allocate_transients(VkPhysicalDevice physical_device, VkDevice device) {
+    struct Candidate {
+        RGResource resource;
+        VkMemoryRequirements requirements;
+    };
+    struct Block {
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+        uint32_t type_bits;
+        std::vector<RGResource> occupants;
+    };
+
+    std::vector<Candidate> candidates;
+    for (RGResource r = 0; r < m_resources.size(); r++) {
+        Resource& resource = m_resources[r];
+        if (resource.imported || resource.first_pass == UINT32_MAX) continue;
+
+        VkImageCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.format = resource.format;
+        info.extent = {resource.extent.width, resource.extent.height, 1};
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.usage = resource.usage;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &info, host_allocator(), &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("failed to create render graph image!");
+
+        Candidate candidate{r};
+        vkGetImageMemoryRequirements(device, resource.image, &candidate.requirements);
+        candidates.push_back(candidate);
+        m_stats.unaliased_bytes += candidate.requirements.size;
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.requirements.size > b.requirements.size; });
+
+    auto overlaps = [&](RGResource a, RGResource b) {
+        return m_resources[a].first_pass <= m_resources[b].last_pass && m_resources[b].first_pass <= m_resources[a].last_pass;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> block_of(m_resources.size(), UINT32_MAX);
+    for (const Candidate& candidate : candidates) {
+        const VkMemoryRequirements& req = candidate.requirements;
+        uint32_t chosen = UINT32_MAX;
+        for (uint32_t b = 0; b < blocks.size() && chosen == UINT32_MAX; b++) {
+            Block& block = blocks[b];
+            if (block.size < req.size || !(block.type_bits & req.memoryTypeBits) || block.alignment % req.alignment != 0)
+                continue;
+            bool free = std::none_of(block.occupants.begin(), block.occupants.end(),
+                                     [&](RGResource other) { return overlaps(other, candidate.resource); });
+            if (free) chosen = b;
+        }
+        if (chosen == UINT32_MAX) {
+            blocks.push_back({req.size, req.alignment, req.memoryTypeBits, {}});
+            chosen = static_cast<uint32_t>(blocks.size() - 1);
+        }
+        blocks[chosen].type_bits &= req.memoryTypeBits;
+        blocks[chosen].occupants.push_back(candidate.resource);
+        block_of[candidate.resource] = chosen;
+    }
+
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    for (Block& block : blocks) {
+        uint32_t type = UINT32_MAX;
+        for (uint32_t i = 0; i < properties.memoryTypeCount && type == UINT32_MAX; i++)
+            if ((block.type_bits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+                type = i;
+        if (type == UINT32_MAX) throw std::runtime_error("failed to find memory type for render graph images!");
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = type;
+
+        if (budget) budget->reserve(type, block.size);
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, host_allocator(), &memory) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate render graph memory!");
+        m_memory.push_back({memory, type, block.size});
+        if (budget) budget->track(type, MemoryCategory::TRANSIENT, static_cast<int64_t>(block.size));
+        m_stats.transient_bytes += block.size;
+
+        // Occupants in lifetime order; each one's predecessor is the image
+        // whose last accesses its first barrier has to wait for.
+        std::sort(block.occupants.begin(), block.occupants.end(),
+                  [&](RGResource a, RGResource b) { return m_resources[a].first_pass < m_resources[b].first_pass; });
+        for (size_t i = 0; i < block.occupants.size(); i++) {
+            Resource& resource = m_resources[block.occupants[i]];
+            if (i > 0) resource.alias_of = block.occupants[i - 1];
+            else if (block.occupants.size() > 1) resource.alias_of = block.occupants.back();
+            vkBindImageMemory(device, resource.image, memory, 0);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.format;
+            viewInfo.subresourceRange = {resource.aspect, 0, 1, 0, 1};
+
+            if (vkCreateImageView(device, &viewInfo, host_allocator(), &resource.view) != VK_SUCCESS)
+                throw std::runtime_error("failed to create render graph image view!");
+        }
+    }
+}
+
+// ---------------- execute ----------------
+void RenderGraph::execute(VkCommandBuffer command_buffer, GpuProfiler* profiler) {
+    if (!m_compiled) throw std::runtime_error("render graph executed before compile!");
+
+    // Transients are single-buffered, so their first barriers wait for
+    // the previous frame's last accesses; only the contents are dropped.
+    for (size_t r = 0; r < m_resources.size(); r++) {
+        if (m_resources[r].imported)
+            m_states[r] = {m_resources[r].initial_layout, 0, 0, false};
+        else
+            m_states[r].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    m_stats.barriers = 0;
+
+    std::vector<VkImageMemoryBarrier> barriers;
+    auto flush = [&](VkPipelineStageFlags src, VkPipelineStageFlags dst) {
+        if (barriers.empty()) return;
+        vkCmdPipelineBarrier(command_buffer, src ? src : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst, 0,
+                             0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        m_stats.barriers += static_cast<uint32_t>(barriers.size());
+        barriers.clear();
+    };
+    auto barrier = [&](RGResource r, const State& from, VkImageLayout layout, VkAccessFlags access) {
+        VkImageMemoryBarrier b{};
+        b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        b.srcAccessMask = from.written ? from.access : 0;
+        b.dstAccessMask = access;
+        b.oldLayout = from.layout;
+        b.newLayout = layout;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.image = m_resources[r].image;
+        b.subresourceRange = {m_resources[r].aspect, 0, 1, 0, 1};
+        barriers.push_back(b);
+    };
+
+    for (uint32_t p = 0; p < m_order.size(); p++) {
+        Pass& pass = m_passes[m_order[p]];
+
+        VkPipelineStageFlags src = 0;
+        VkPipelineStageFlags dst = 0;
+        for (const Use& use : pass.uses) {
+            UsageInfo info = usage_info(use.usage);
+            State& state = m_states[use.resource];
+            const Resource& resource = m_resources[use.resource];
+
+            // First use of an aliased transient: wait for the previous
+            // occupant of its memory instead (for the block's first
+            // occupant, the last one as the previous frame left it).
+            State from = state;
+            if (!resource.imported && resource.first_pass == p && resource.alias_of != UINT32_MAX) {
+                from = m_states[resource.alias_of];
+                from.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                from.written = true;
+            }
+
+            // Read after read in the same layout needs nothing; the
+            // stages are remembered so a later write waits for all readers.
+            bool needed = from.layout != info.layout || from.written || info.write || from.stage == 0;
+            if (!needed) {
+                state.stage |= info.stage;
+                state.access |= info.access;
+                continue;
+            }
+            barrier(use.resource, from, info.layout, info.access);
+            src |= from.stage;
+            dst |= info.stage;
+            state = {info.layout, info.stage, info.access, info.write};
+        }
+        flush(src, dst);
+
+        if (profiler) {
+            GpuScope scope(*profiler, command_buffer, pass.name);
+            pass.execute(command_buffer);
+        } else {
+            pass.execute(command_buffer);
+        }
+    }
+
+    // Outputs end in their final layout, visible to anything after the graph.
+    VkPipelineStageFlags src = 0;
+    for (RGResource r = 0; r < m_resources.size(); r++) {
+        const Resource& resource = m_resources[r];
+        if (resource.final_layout == VK_IMAGE_LAYOUT_UNDEFINED || resource.first_pass == UINT32_MAX) continue;
+        State& state = m_states[r];
+        if (state.layout == resource.final_layout && !state.written) continue;
+        barrier(r, state, resource.final_layout, VK_ACCESS_MEMORY_READ_BIT);
+        src |= state.stage;
+        state = {resource.final_layout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT, false};
+    }
+    flush(src, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+}
+
+void RenderGraph::release(VkDevice device, DeletionQueue* retired, uint64_t value) {
+    for (Resource& resource : m_resources) {
+        if (resource.imported) continue;
+        if (retired) {
+            if (resource.view) retired->retire(value, resource.view);
+            if (resource.image) retired->retire(value, resource.image);
+        } else {
+            if (resource.view) vkDestroyImageView(device, resource.view, host_allocator());
+            if (resource.image) vkDestroyImage(device, resource.image, host_allocator());
+        }
+        resource.image = VK_NULL_HANDLE;
+        resource.view = VK_NULL_HANDLE;
+    }
+    for (const Memory& memory : m_memory) {
+        if (budget) budget->track(memory.type, MemoryCategory::TRANSIENT, -static_cast<int64_t>(memory.size));
+        if (retired) retired->retire(value, memory.memory);
+        else vkFreeMemory(device, memory.memory, host_allocator());
+    }
+    m_memory.clear();
+}
+
+void RenderGraph::reset(VkDevice device) {
+    release(device, nullptr, 0);
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_states.clear();
+    m_stats = {};
+    m_compiled = false;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "deletion_queue.h"
+#include "memory_budget.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct GpuProfiler;
+
+using RGResource = uint32_t;
+using RGPass = uint32_t;
+
+// How a pass touches an image; decides layout, stages and access masks.
+enum class RGUsage : uint8_t {
+    COLOR_ATTACHMENT,
+    DEPTH_ATTACHMENT,
+    DEPTH_READ,
+    SAMPLED,
+    STORAGE_READ,
+    STORAGE_WRITE,
+    TRANSFER_SRC,
+    TRANSFER_DST,
+};
+
+// Frame render graph. Passes declare the images they read and write;
+// compile() culls passes whose results nobody uses, orders the rest by
+// their read/write dependencies (a read sees the last write declared
+// before it), computes resource lifetimes and places transient images with
+// non-overlapping lifetimes in the same memory. execute() records the live
+// passes in that order with the minimal barriers and layout transitions
+// between them, merged into one vkCmdPipelineBarrier per pass.
+//
+// Built once, executed every frame; imports can be repointed per frame
+// (e.g. the acquired swapchain image). Passes record their own rendering
+// begin/end. Names must outlive the graph (string literals): they are
+// also GPU profiler scope names.
+struct RenderGraph {
+    // An image owned elsewhere. It arrives in `initial_layout` each frame
+    // and is left in `final_layout`; a final layout other than UNDEFINED
+    // makes it a graph output.
+    RGResource import_image(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+                            VkImageAspectFlags aspect, VkImageLayout initial_layout, VkImageLayout final_layout);
+    void update_import(RGResource resource, VkImage image, VkImageView view);
+    // A graph-owned image, created by compile() with the union of its
+    // usages. Its contents do not survive the frame unless exported.
+    RGResource create_image(const char* name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect);
+    // Keeps a transient's producers alive and leaves it in `final_layout`
+    // for work recorded after the graph (e.g. the main pass sampling it).
+    void export_image(RGResource resource, VkImageLayout final_layout);
+
+    RGPass add_pass(const char* name, std::function<void(VkCommandBuffer)> execute);
+    void use(RGPass pass, RGResource resource, RGUsage usage);
+    // Never culled, for passes with effects outside the graph. Kept passes
+    // run in declaration order relative to each other.
+    void keep(RGPass pass);
+
+    // Recompiling creates new transients. The old ones are retired into
+    // `retired` at `value` when given, otherwise destroyed right away (the
+    // device must be done with the last execute()).
+    void compile(VkPhysicalDevice physical_device, VkDevice device, DeletionQueue* retired = nullptr, uint64_t value = 0);
+    void execute(VkCommandBuffer command_buffer, GpuProfiler* profiler = nullptr);
+    // Destroys the transients and forgets every pass and resource. The
+    // device must be done with the last execute().
+    void reset(VkDevice device);
+
+    bool empty() const { return m_passes.empty(); }
+    bool compiled() const { return m_compiled; }
+    VkImage image(RGResource resource) const { return m_resources[resource].image; }
+    VkImageView view(RGResource resource) const { return m_resources[resource].view; }
+    VkExtent2D extent(RGResource resource) const { return m_resources[resource].extent; }
+
+    struct Stats {
+        uint32_t passes = 0;
+        uint32_t culled_passes = 0;
+        uint32_t barriers = 0;
+        // Memory the transients occupy, and what it would be unaliased.
+        VkDeviceSize transient_bytes = 0;
+        VkDeviceSize unaliased_bytes = 0;
+    };
+    const Stats& stats() const { return m_stats; }
+
+    // Optional; transient memory is reported to it as TRANSIENT.
+    MemoryBudget* budget = nullptr;
+
+    private:
+    struct Resource {
+        const char* name;
+        bool imported;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFormat format;
+        VkExtent2D extent;
+        VkImageAspectFlags aspect;
+        VkImageUsageFlags usage = 0;
+        VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // range of positions in m_order, UINT32_MAX if unused
+        uint32_t first_pass = UINT32_MAX;
+        uint32_t last_pass = 0;
+        // transient that last used the same memory (the block's last
+        // occupant, from the previous frame, for its first), UINT32_MAX if none
+        RGResource alias_of = UINT32_MAX;
+    };
+
+    struct Use {
+        RGResource resource;
+        RGUsage usage;
+    };
+
+    struct Pass {
+        const char* name;
+        std::function<void(VkCommandBuffer)> execute;
+        std::vector<Use> uses;
+        bool side_effect = false;
+        bool live = false;
+    };
+
+    // Last access to each image. Kept across execute() calls for
+    // transients, which every frame in flight shares.
+    struct State {
+        VkImageLayout layout;
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        bool written;
+    };
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    // live passes in execution order
+    std::vector<RGPass> m_order;
+    struct Memory {
+        VkDeviceMemory memory;
+        uint32_t type;
+        VkDeviceSize size;
+    };
+    std::vector<Memory> m_memory;
+    std::vector<State> m_states;
+    bool m_compiled = false;
+    Stats m_stats;
+
+    void cull();
+    void sort();
+    void allocate_transients(VkPhysicalDevice physical_device, VkDevice device);
+    void release(VkDevice device, DeletionQueue* retired, uint64_t value);
+};
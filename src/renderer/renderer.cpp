@@ -1,6 +1,16 @@
 #include "renderer.h"
+#include "host_allocator.h"
 #include "../const.h"
+#include "spirv_reflect.h"
+#include "push_constants.h"
 #include "../utils/file.h"
+#include "../utils/texture_asset.h"
+#include "../profiler/profiler.h"
+
+#include <cstring>
+#include <filesystem>
+
+const VkShaderStageFlags BINDLESS_PUSH_STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -9,6 +19,9 @@ const std::vector<const char*> deviceExtensions = {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Dedicated families when the device has them, else the graphics family.
+    std::optional<uint32_t> computeFamily;
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -21,6 +34,8 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
+
 // ---------------- core ----------------
 void Renderer::init_renderer(Window* wind) {
     // initWindow(); // window.h
@@ -28,40 +43,110 @@ void Renderer::init_renderer(Window* wind) {
     init_vulkan();
 }
 
+// No window, surface or swapchain: frames are rendered into offscreen
+// images, which works on display-less machines and CPU implementations
+// such as lavapipe.
+void Renderer::init_headless() {
+    headless = true;
+    window = nullptr;
+    init_vulkan();
+}
+
 void Renderer::init_vulkan() {
     create_instance();
-    window->create_surface(instance, &surface);
+    if (!headless) window->create_surface(instance, &surface);
     pick_physical_device();
     create_logical_device();
-    create_swapchain();
-    create_image_views();
+    memory_budget.init(physical_device, memory_budget_supported);
+    allocator.init(physical_device, device, &memory_budget);
+    graph.budget = &memory_budget;
+    sampler_cache.init(device);
+    create_descriptor_allocators();
+    if (headless) {
+        create_offscreen_targets();
+    } else {
+        create_swapchain();
+        create_image_views();
+    }
+    create_depth_resources();
     create_renderpass();
     create_graphics_pipeline();
     create_framebuffers();
     create_command_pool();
     create_command_buffers();
     create_sync_objects();
+    gpu_profiler.init(physical_device, device, graphics_family, rune::MAX_FRAMES_IN_FLIGHT);
+    if (capture_supported)
+        frame_capture.init(physical_device, device, swapchain_extent, swapchain_image_format, rune::MAX_FRAMES_IN_FLIGHT, jobs,
+                           &memory_budget);
+}
+
+// Queued, never blocks: the file is written a few frames later by a worker.
+void Renderer::capture(const std::string& path) {
+    bool ppm = path.size() >= 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+    frame_capture.request(path, ppm ? CaptureFormat::PPM : CaptureFormat::PNG);
 }
 
 void Renderer::deinit() {
-    vkDestroySemaphore(device, render_finished_semaphore, nullptr);
-    vkDestroySemaphore(device, image_available_semaphore, nullptr);
-    vkDestroyCommandPool(device, command_pool, nullptr);
+    vkDeviceWaitIdle(device);
+    frame_capture.deinit(device);
+    buffers.for_each([&](BufferHandle, VulkanBuffer& buffer) { buffer.deinit(device); });
+    images.for_each([&](ImageHandle handle, GpuImage&) { destroy(handle); });
+    pipelines.for_each([&](PipelineHandle handle, GpuPipeline&) { destroy(handle); });
+    samplers.for_each([&](SamplerHandle handle, GpuSampler&) { destroy(handle); });
+    streamer.deinit(device);
+    for (auto& [buffer, allocation] : pending_staging) vkDestroyBuffer(device, buffer, host_allocator());
+    pending_staging.clear();
+    pending_uploads.clear();
+    deletion_queue.flush(device);
+    graph.reset(device);
+    sampler_cache.deinit();
+    allocator.deinit();
+    gpu_profiler.deinit(device);
+    graphics_timeline.deinit(device);
+    compute_timeline.deinit(device);
+    transfer_timeline.deinit(device);
+    for (size_t i = 0; i < rune::MAX_FRAMES_IN_FLIGHT; i++) {
+        vkDestroySemaphore(device, render_finished_semaphores[i], host_allocator());
+        vkDestroySemaphore(device, image_available_semaphores[i], host_allocator());
+    }
+    vkDestroyCommandPool(device, command_pool, host_allocator());
+    vkDestroyCommandPool(device, compute_command_pool, host_allocator());
+    vkDestroyCommandPool(device, transfer_command_pool, host_allocator());
+    pending_transfers.clear();
 
     for (auto framebuffer : swapchain_framebuffers)
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-
-    vkDestroyPipeline(device, graphics_pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
-    vkDestroyRenderPass(device, render_pass, nullptr);
+        vkDestroyFramebuffer(device, framebuffer, host_allocator());
+
+    vkDestroyPipeline(device, graphics_pipeline, host_allocator());
+    vkDestroyPipeline(device, depth_pipeline, host_allocator());
+    bindless.deinit(device);
+    lighting.deinit(device);
+    for (auto& allocator : frame_descriptors) allocator.deinit();
+    pipeline_layout_cache.deinit();
+    layout_cache.deinit();
+    vkDestroyRenderPass(device, render_pass, host_allocator());
+    vkDestroyImageView(device, depth_view, host_allocator());
+    vkDestroyImage(device, depth_image, host_allocator());
+    vkFreeMemory(device, depth_memory, host_allocator());
+    vkDestroyImageView(device, msaa_view, host_allocator());
+    vkDestroyImage(device, msaa_image, host_allocator());
+    vkFreeMemory(device, msaa_memory, host_allocator());
 
     for (auto imageView : swapchain_image_views)
-        vkDestroyImageView(device, imageView, nullptr);
+        vkDestroyImageView(device, imageView, host_allocator());
 
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-    vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
-    vkDestroyInstance(instance, nullptr);
+    if (headless) {
+        for (size_t i = 0; i < swapchain_images.size(); i++) {
+            vkDestroyImage(device, swapchain_images[i], host_allocator());
+            vkFreeMemory(device, offscreen_memory[i], host_allocator());
+        }
+    } else {
+        vkDestroySwapchainKHR(device, swapchain, host_allocator());
+    }
+    vkDestroyDevice(device, host_allocator());
+    if (!headless) vkDestroySurfaceKHR(instance, surface, host_allocator());
+    vkDestroyInstance(instance, host_allocator());
 }
 
 /** 
@@ -74,7 +159,7 @@ VkShaderModule Renderer::create_shader_module(const std::vector<char>& code) {
     createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
     VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    if (vkCreateShaderModule(device, &createInfo, host_allocator(), &shaderModule) != VK_SUCCESS)
         throw std::runtime_error("failed to create shader module!");
     return shaderModule;
 }
@@ -87,10 +172,16 @@ void Renderer::create_instance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "Rune";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Ask for 1.2 (timeline semaphores) when the loader knows it; the device
+    // may still be older, which pick_physical_device() checks.
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    auto enumerateVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    if (enumerateVersion) enumerateVersion(&loaderVersion);
+    appInfo.apiVersion = loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+    instance_version = appInfo.apiVersion;
 
     uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    const char** glfwExtensions = headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -98,7 +189,7 @@ void Renderer::create_instance() {
     createInfo.enabledExtensionCount = glfwExtensionCount;
     createInfo.ppEnabledExtensionNames = glfwExtensions;
 
-    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+    if (vkCreateInstance(&createInfo, host_allocator(), &instance) != VK_SUCCESS)
         throw std::runtime_error("failed to create instance!");
 }
 
@@ -115,15 +206,46 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
         if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
             indices.graphicsFamily = i;
 
+        // headless: nothing is presented, the graphics queue stands in
+        if (surface == VK_NULL_HANDLE) {
+            indices.presentFamily = indices.graphicsFamily;
+            if (indices.isComplete()) break;
+            continue;
+        }
+
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         if (presentSupport) indices.presentFamily = i;
 
         if (indices.isComplete()) break;
     }
+
+    // Async compute / transfer: prefer families without graphics so the work
+    // runs beside the graphics queue instead of being serialized on it.
+    for (uint32_t i = 0; i < count; i++) {
+        VkQueueFlags flags = families[i].queueFlags;
+        if (!indices.computeFamily && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            indices.computeFamily = i;
+        if (!indices.transferFamily && (flags & VK_QUEUE_TRANSFER_BIT) &&
+            !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            indices.transferFamily = i;
+    }
+    if (!indices.computeFamily) indices.computeFamily = indices.graphicsFamily;
+    if (!indices.transferFamily) indices.transferFamily = indices.computeFamily;
     return indices;
 }
 
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t count;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> available(count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, available.data());
+
+    for (auto& ext : available)
+        if (strcmp(ext.extensionName, name) == 0) return true;
+    return false;
+}
+
 bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
     uint32_t count;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
@@ -157,6 +279,8 @@ SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurface
 
 bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
     QueueFamilyIndices indices = findQueueFamilies(device, surface);
+    if (surface == VK_NULL_HANDLE) return indices.isComplete();
+
     bool extensionsSupported = checkDeviceExtensionSupport(device);
     bool swapchainAdequate = false;
     if (extensionsSupported) {
@@ -182,6 +306,49 @@ void Renderer::pick_physical_device() {
     }
     if (physical_device == VK_NULL_HANDLE)
         throw std::runtime_error("failed to find suitable GPU!");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (instance_version >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        bool dynamicRenderingExtension = allow_dynamic_rendering && hasDeviceExtension(physical_device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        if (dynamicRenderingExtension) features12.pNext = &dynamicRenderingFeatures;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(physical_device, &features);
+        timeline_supported = features12.timelineSemaphore;
+        bindless_supported = BindlessHeap::supported(features12);
+        dynamic_rendering = dynamicRenderingExtension && dynamicRenderingFeatures.dynamicRendering;
+        // Queried through vkGetPhysicalDeviceMemoryProperties2, core in 1.1.
+        memory_budget_supported = hasDeviceExtension(physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (!timeline_supported)
+        std::cout << "Timeline semaphores not available, falling back to fences\n";
+    if (!bindless_supported)
+        std::cout << "Descriptor indexing not available, bindless resources disabled\n";
+    if (!dynamic_rendering)
+        std::cout << "Dynamic rendering not available, using render pass objects\n";
+
+    // sample_streamed() writes its feedback with atomicMin from fragment shaders.
+    VkPhysicalDeviceFeatures supported;
+    vkGetPhysicalDeviceFeatures(physical_device, &supported);
+    if (texture_streaming && !supported.fragmentStoresAndAtomics) {
+        std::cout << "Fragment stores and atomics not available, texture streaming disabled\n";
+        texture_streaming = false;
+    }
+
+    VkSampleCountFlags sampleCounts = properties.limits.framebufferColorSampleCounts &
+                                      properties.limits.framebufferDepthSampleCounts;
+    VkSampleCountFlagBits requested = msaa_samples;
+    if (msaa_samples > VK_SAMPLE_COUNT_8_BIT) msaa_samples = VK_SAMPLE_COUNT_8_BIT;
+    while (msaa_samples > VK_SAMPLE_COUNT_1_BIT && !(sampleCounts & msaa_samples))
+        msaa_samples = static_cast<VkSampleCountFlagBits>(msaa_samples >> 1);
+    if (msaa_samples != requested)
+        std::cout << "MSAA " << requested << "x not available, using " << msaa_samples << "x\n";
 }
 
 uint32_t Renderer::find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
@@ -202,7 +369,8 @@ void Renderer::create_logical_device() {
     QueueFamilyIndices indices = findQueueFamilies(physical_device, surface);
 
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
-    std::set<uint32_t> uniqueQueues = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueues = {indices.graphicsFamily.value(), indices.presentFamily.value(),
+                                       indices.computeFamily.value(), indices.transferFamily.value()};
     float priority = 1.0f;
 
     for (uint32_t queueFamily : uniqueQueues) {
@@ -215,20 +383,51 @@ void Renderer::create_logical_device() {
     }
 
     VkPhysicalDeviceFeatures features{};
+    features.fragmentStoresAndAtomics = texture_streaming;
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = timeline_supported;
+    if (bindless_supported) BindlessHeap::enable(features12);
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    if (dynamic_rendering) features12.pNext = &dynamicRenderingFeatures;
+
+    std::vector<const char*> extensions;
+    if (!headless) extensions = deviceExtensions;
+    if (dynamic_rendering) extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    if (memory_budget_supported) extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = timeline_supported || bindless_supported || dynamic_rendering ? &features12 : nullptr;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
     createInfo.pQueueCreateInfos = queueInfos.data();
     createInfo.pEnabledFeatures = &features;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
-    if (vkCreateDevice(physical_device, &createInfo, nullptr, &device) != VK_SUCCESS)
+    if (vkCreateDevice(physical_device, &createInfo, host_allocator(), &device) != VK_SUCCESS)
         throw std::runtime_error("failed to create device!");
 
+    if (dynamic_rendering) {
+        cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+        cmd_end_rendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+        dynamic_rendering = cmd_begin_rendering && cmd_end_rendering;
+    }
+
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphics_queue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &present_queue);
+    vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &compute_queue);
+    vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transfer_queue);
+
+    graphics_family = indices.graphicsFamily.value();
+    compute_family = indices.computeFamily.value();
+    transfer_family = indices.transferFamily.value();
+    if (compute_family != graphics_family) std::cout << "Using async compute queue family " << compute_family << "\n";
+    if (transfer_family != graphics_family) std::cout << "Using transfer queue family " << transfer_family << "\n";
 }
 
 // ---------------- swapchain ----------------
@@ -277,6 +476,8 @@ void Renderer::create_swapchain() {
     info.imageExtent = extent;
     info.imageArrayLayers = 1;
     info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    capture_supported = support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (capture_supported) info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
     QueueFamilyIndices indices = findQueueFamilies(physical_device, surface);
     uint32_t queueIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -293,7 +494,7 @@ void Renderer::create_swapchain() {
     info.presentMode = presentMode;
     info.clipped = VK_TRUE;
 
-    if (vkCreateSwapchainKHR(device, &info, nullptr, &swapchain) != VK_SUCCESS)
+    if (vkCreateSwapchainKHR(device, &info, host_allocator(), &swapchain) != VK_SUCCESS)
         throw std::runtime_error("failed to create swapchain!");
 
     vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
@@ -317,38 +518,222 @@ void Renderer::create_image_views() {
         info.subresourceRange.levelCount = 1;
         info.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(device, &info, nullptr, &swapchain_image_views[i]) != VK_SUCCESS)
+        if (vkCreateImageView(device, &info, host_allocator(), &swapchain_image_views[i]) != VK_SUCCESS)
             throw std::runtime_error("failed to create image view!");
     }
 }
 
+// Headless stand-in for the swapchain: one color target per frame in flight,
+// kept in swapchain_images/swapchain_image_views so the rest of the
+// renderer does not care which one it draws to.
+void Renderer::create_offscreen_targets() {
+    swapchain_image_format = VK_FORMAT_R8G8B8A8_SRGB;
+    capture_supported = true;
+    swapchain_extent = {rune::WIDTH, rune::HEIGHT};
+    swapchain_images.resize(rune::MAX_FRAMES_IN_FLIGHT);
+    offscreen_memory.resize(rune::MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < swapchain_images.size(); i++) {
+        VkImageCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.format = swapchain_image_format;
+        info.extent = {swapchain_extent.width, swapchain_extent.height, 1};
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &info, host_allocator(), &swapchain_images[i]) != VK_SUCCESS)
+            throw std::runtime_error("failed to create offscreen image!");
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, swapchain_images[i], &requirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = find_memory_type(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, host_allocator(), &offscreen_memory[i]) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate offscreen image memory!");
+        memory_budget.track(allocInfo.memoryTypeIndex, MemoryCategory::TRANSIENT, static_cast<int64_t>(requirements.size));
+        vkBindImageMemory(device, swapchain_images[i], offscreen_memory[i], 0);
+    }
+
+    create_image_views();
+}
+
+VkFormat Renderer::find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
+    for (VkFormat format : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
+
+        if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
+            return format;
+        if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+            return format;
+    }
+    throw std::runtime_error("failed to find supported format!");
+}
+
+bool hasStencilComponent(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+// A main pass target at msaa_samples. These never leave the pass (loaded
+// with CLEAR, stored with DONT_CARE), so they are transient attachments;
+// tile-based GPUs back them with lazily allocated memory that never gets
+// physical pages. Elsewhere that memory type does not exist and they fall
+// back to plain device-local memory.
+void Renderer::create_attachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                 VkImage& image, VkDeviceMemory& memory, VkImageView& view) {
+    VkImageCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = format;
+    info.extent = {swapchain_extent.width, swapchain_extent.height, 1};
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = msaa_samples;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &info, host_allocator(), &image) != VK_SUCCESS)
+        throw std::runtime_error("failed to create attachment image!");
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memProperties);
+    const VkMemoryPropertyFlags lazy = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    uint32_t memoryType = UINT32_MAX;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        if ((requirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & lazy) == lazy)
+            memoryType = i;
+    if (memoryType == UINT32_MAX)
+        memoryType = find_memory_type(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    if (vkAllocateMemory(device, &allocInfo, host_allocator(), &memory) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate attachment memory!");
+    // Lazily allocated memory has no pages behind it, so it only counts
+    // towards the category.
+    if (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+        memory_budget.track_category(MemoryCategory::TRANSIENT, static_cast<int64_t>(requirements.size));
+    else
+        memory_budget.track(memoryType, MemoryCategory::TRANSIENT, static_cast<int64_t>(requirements.size));
+    vkBindImageMemory(device, image, memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {aspect, 0, 1, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, host_allocator(), &view) != VK_SUCCESS)
+        throw std::runtime_error("failed to create attachment image view!");
+}
+
+// One depth target is enough for every frame in flight: the main pass
+// dependency orders each frame's depth writes after the previous one's.
+// The same goes for the multisampled color target.
+void Renderer::create_depth_resources() {
+    depth_format = find_supported_format({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+                                         VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    create_attachment(depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                      depth_image, depth_memory, depth_view);
+    if (msaa_samples != VK_SAMPLE_COUNT_1_BIT)
+        create_attachment(swapchain_image_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                          msaa_image, msaa_memory, msaa_view);
+}
+
 // ---------------- pipeline ----------------
 void Renderer::create_renderpass() {
+    if (dynamic_rendering) return;
+
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = swapchain_image_format;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // With MSAA the samples stay in the pass and only the resolve into the
+    // swapchain image is written out.
+    bool multisampled = msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+    VkAttachmentDescription resolveAttachment = colorAttachment;
+    resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    if (multisampled) {
+        colorAttachment.samples = msaa_samples;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    // Depth is never read after the pass, so it is not stored.
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depth_format;
+    depthAttachment.samples = msaa_samples;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference ref{};
     ref.attachment = 0;
     ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depthRef{};
+    depthRef.attachment = 1;
+    depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference resolveRef{};
+    resolveRef.attachment = 2;
+    resolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &ref;
+    subpass.pDepthStencilAttachment = &depthRef;
+    if (multisampled) subpass.pResolveAttachments = &resolveRef;
+
+    // The shared depth (and multisampled color) image is cleared while the
+    // previous frame may still be rendering to it.
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkAttachmentDescription attachments[] = {colorAttachment, depthAttachment, resolveAttachment};
 
     VkRenderPassCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    info.attachmentCount = 1;
-    info.pAttachments = &colorAttachment;
+    info.attachmentCount = multisampled ? 3 : 2;
+    info.pAttachments = attachments;
     info.subpassCount = 1;
     info.pSubpasses = &subpass;
+    info.dependencyCount = 1;
+    info.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(device, &info, nullptr, &render_pass) != VK_SUCCESS)
+    if (vkCreateRenderPass(device, &info, host_allocator(), &render_pass) != VK_SUCCESS)
         throw std::runtime_error("failed to create render pass!");
 }
 
@@ -356,17 +741,77 @@ void Renderer::create_renderpass() {
  * GOING TO pipeline.cpp 
  */
 void Renderer::create_graphics_pipeline() {
-    auto vertCode = read_file("./assets/shaders/tri.vert.spv");
-    auto fragCode = read_file("./assets/shaders/tri.frag.spv");
+    // These are not checked in; they come from make shaders.
+    if (clustered_lighting) {
+        for (const char* path : {"./assets/shaders/lit.vert.spv", "./assets/shaders/lit.frag.spv",
+                                 "./assets/shaders/cluster_lights.comp.spv"}) {
+            if (std::filesystem::exists(path)) continue;
+            std::cout << path << " missing (make shaders), clustered lighting disabled\n";
+            clustered_lighting = false;
+            break;
+        }
+    }
+
+    // The clustered path shades with lit.frag, which needs view-space inputs.
+    std::string shader = clustered_lighting ? "lit" : "tri";
+    auto vertCode = read_file("./assets/shaders/" + shader + ".vert.spv");
+    auto fragCode = read_file("./assets/shaders/" + shader + ".frag.spv");
 
     VkShaderModule vertModule = create_shader_module(vertCode);
+    VkShaderModule fragModule = create_shader_module(fragCode);
+
+    if (bindless_supported) bindless.init(physical_device, device);
+    if (clustered_lighting)
+        lighting.init(physical_device, device, swapchain_extent, rune::MAX_FRAMES_IN_FLIGHT,
+                      read_file("./assets/shaders/cluster_lights.comp.spv"), layout_cache, pipeline_layout_cache,
+                      &memory_budget);
+    if (texture_streaming && bindless_supported) {
+        streamer.init(physical_device, device, rune::MAX_FRAMES_IN_FLIGHT, allocator, bindless,
+                      get_sampler(default_sampler_info()), jobs, layout_cache, &memory_budget);
+
+        // Under device memory pressure, stream at lower resolution: the
+        // finest levels go at the next begin_frame(). The budget stays
+        // lowered for the rest of the run.
+        memory_budget.on_pressure([this](uint32_t heap, VkDeviceSize excess) -> VkDeviceSize {
+            if (!memory_budget.heap(heap).device_local) return 0;
+            VkDeviceSize resident = streamer.stats().resident_bytes;
+            VkDeviceSize target = resident > excess ? resident - excess : 0;
+            if (target >= streamer.budget) return 0;
+            streamer.budget = target;
+            std::cout << "Texture streaming budget lowered to " << (target >> 20) << " MiB\n";
+            return resident - target;
+        });
+    }
+
+    // Every pipeline built on this layout shares the engine's sets and the
+    // per-draw index block, so the sets are bound once per command buffer.
+    ShaderReflection vertReflection = reflect_spirv(vertCode);
+    pipeline_layout = reflect_pipeline_layout({vertReflection, reflect_spirv(fragCode)});
+
+    if (depth_prepass && !vertReflection.invariant_position) {
+        std::cout << "Vertex shader position not invariant (make shaders), depth pre-pass disabled\n";
+        depth_prepass = false;
+    }
+    graphics_pipeline = build_graphics_pipeline(vertModule, fragModule, &vertReflection);
+    if (depth_prepass) depth_pipeline = build_depth_pipeline(vertModule, &vertReflection);
+
+    vkDestroyShaderModule(device, fragModule, host_allocator());
+    vkDestroyShaderModule(device, vertModule, host_allocator());
+}
+
+// Builds a pipeline for the main render pass. Split out so tools can create
+// extra pipelines from the same state. Without a fragment module it is a
+// depth-only pipeline for the pre-pass.
+VkPipeline Renderer::build_graphics_pipeline(VkShaderModule vertModule, VkShaderModule fragModule,
+                                             const ShaderReflection* vertex, VkPipelineLayout layout) {
+    bool depthOnly = fragModule == VK_NULL_HANDLE;
+
     VkPipelineShaderStageCreateInfo vertStage{};
     vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertStage.module = vertModule;
     vertStage.pName = "main";
 
-    VkShaderModule fragModule = create_shader_module(fragCode);
     VkPipelineShaderStageCreateInfo fragStage{};
     fragStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -375,8 +820,19 @@ void Renderer::create_graphics_pipeline() {
 
     VkPipelineShaderStageCreateInfo stages[] = {vertStage, fragStage};
 
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    VkVertexInputBindingDescription binding{};
+    if (vertex) binding.stride = reflect_vertex_attributes(*vertex, attributes);
+
     VkPipelineVertexInputStateCreateInfo vertexInfo{};
     vertexInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    if (!attributes.empty()) {
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        vertexInfo.vertexBindingDescriptionCount = 1;
+        vertexInfo.pVertexBindingDescriptions = &binding;
+        vertexInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+        vertexInfo.pVertexAttributeDescriptions = attributes.data();
+    }
 
     VkPipelineInputAssemblyStateCreateInfo assembly{};
     assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -409,80 +865,110 @@ void Renderer::create_graphics_pipeline() {
 
     VkPipelineMultisampleStateCreateInfo multisample{};
     multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisample.rasterizationSamples = msaa_samples;
+
+    // Reversed-Z. GREATER_OR_EQUAL rather than GREATER so geometry at the
+    // far plane (z = 0) still draws; after a pre-pass shading only runs
+    // where its fragment is the one that won.
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = depthOnly || !depth_prepass;
+    depthStencil.depthCompareOp = depth_prepass && !depthOnly ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_GREATER_OR_EQUAL;
 
     VkPipelineColorBlendAttachmentState blend{};
-    blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    if (!depthOnly)
+        blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                               VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 
     VkPipelineColorBlendStateCreateInfo blending{};
     blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     blending.attachmentCount = 1;
     blending.pAttachments = &blend;
 
-    VkPipelineLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipeline_layout) != VK_SUCCESS)
-        throw std::runtime_error("failed to create pipeline layout!");
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &swapchain_image_format;
+    renderingInfo.depthAttachmentFormat = depth_format;
+    if (hasStencilComponent(depth_format)) renderingInfo.stencilAttachmentFormat = depth_format;
 
     VkGraphicsPipelineCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    info.stageCount = 2;
+    info.pNext = dynamic_rendering ? &renderingInfo : nullptr;
+    info.stageCount = depthOnly ? 1 : 2;
     info.pStages = stages;
     info.pVertexInputState = &vertexInfo;
     info.pInputAssemblyState = &assembly;
     info.pViewportState = &viewportState;
     info.pRasterizationState = &raster;
     info.pMultisampleState = &multisample;
+    info.pDepthStencilState = &depthStencil;
     info.pColorBlendState = &blending;
-    info.layout = pipeline_layout;
+    info.layout = layout ? layout : pipeline_layout;
     info.renderPass = render_pass;
     info.subpass = 0;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &graphics_pipeline) != VK_SUCCESS)
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, host_allocator(), &pipeline) != VK_SUCCESS)
         throw std::runtime_error("failed to create graphics pipeline!");
+    return pipeline;
+}
 
-    vkDestroyShaderModule(device, fragModule, nullptr);
-    vkDestroyShaderModule(device, vertModule, nullptr);
+VkPipeline Renderer::build_depth_pipeline(VkShaderModule vertModule, const ShaderReflection* vertex,
+                                          VkPipelineLayout layout) {
+    return build_graphics_pipeline(vertModule, VK_NULL_HANDLE, vertex, layout);
 }
 
 // ---------------- framebuffers & commands ----------------
 void Renderer::create_framebuffers() {
+    if (dynamic_rendering) return;
+
     swapchain_framebuffers.resize(swapchain_image_views.size());
 
     for (size_t i = 0; i < swapchain_image_views.size(); i++) {
-        VkImageView attachments[] = {swapchain_image_views[i]};
+        bool multisampled = msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+        VkImageView attachments[] = {multisampled ? msaa_view : swapchain_image_views[i], depth_view, swapchain_image_views[i]};
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = render_pass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = multisampled ? 3 : 2;
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = swapchain_extent.width;
         framebufferInfo.height = swapchain_extent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapchain_framebuffers[i]) != VK_SUCCESS) {
+        if (vkCreateFramebuffer(device, &framebufferInfo, host_allocator(), &swapchain_framebuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create framebuffer!");
         }
     }
 }
 
 void Renderer::create_command_pool() {
-    QueueFamilyIndices indices = findQueueFamilies(physical_device, surface);
-
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = indices.graphicsFamily.value();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = graphics_family;
 
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &command_pool) != VK_SUCCESS) {
+    if (vkCreateCommandPool(device, &poolInfo, host_allocator(), &command_pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    poolInfo.queueFamilyIndex = compute_family;
+    if (vkCreateCommandPool(device, &poolInfo, host_allocator(), &compute_command_pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute command pool!");
+    }
+
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = transfer_family;
+    if (vkCreateCommandPool(device, &poolInfo, host_allocator(), &transfer_command_pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
 }
 
 void Renderer::create_command_buffers() {
-    command_buffers.resize(swapchain_framebuffers.size());
+    command_buffers.resize(rune::MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -494,86 +980,600 @@ void Renderer::create_command_buffers() {
         throw std::runtime_error("failed to allocate command buffers!");
     }
 
-    for (size_t i = 0; i < command_buffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    compute_command_buffers.resize(rune::MAX_FRAMES_IN_FLIGHT);
+    allocInfo.commandPool = compute_command_pool;
+    if (vkAllocateCommandBuffers(device, &allocInfo, compute_command_buffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate compute command buffers!");
+    }
+}
+
+// Re-recorded every frame so per-frame state (timestamp queries, and later
+// dynamic draw lists) can go into it.
+void Renderer::record_command_buffer(VkCommandBuffer command_buffer, uint32_t image_index) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        if (vkBeginCommandBuffer(command_buffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("failed to begin recording command buffer!");
+    if (vkBeginCommandBuffer(command_buffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    gpu_profiler.begin_frame(device, command_buffer, current_frame);
+    if (!pending_uploads.empty()) {
+        GpuScope scope(gpu_profiler, command_buffer, "texture upload");
+        record_texture_uploads(command_buffer, pending_uploads);
+        for (auto& [buffer, allocation] : pending_staging) {
+            retire(buffer);
+            allocator.free(allocation, graphics_timeline.submitted() + 1);
         }
+        pending_uploads.clear();
+        pending_staging.clear();
+    }
+    if (streamer.enabled()) {
+        GpuScope scope(gpu_profiler, command_buffer, "texture streaming");
+        streamer.record(command_buffer, current_frame, graphics_timeline.submitted() + 1,
+                        allocate_frame_set(streamer.layout()));
+    }
+    if (pre_pass) pre_pass(command_buffer);
+    if (!graph.empty()) {
+        // The previous frames may still use the old transients.
+        if (!graph.compiled()) graph.compile(physical_device, device, &deletion_queue, graphics_timeline.submitted() + 1);
+        graph.execute(command_buffer, &gpu_profiler);
+    }
+    if (lighting.enabled()) {
+        GpuScope scope(gpu_profiler, command_buffer, "light binning");
+        lighting.record(command_buffer, current_frame, allocate_frame_set(lighting.layout()));
+    }
+    {
+        GpuScope scope(gpu_profiler, command_buffer, "main pass");
+        begin_main_pass(command_buffer, image_index);
+
+        // Every graphics layout shares these sets, so they stay bound
+        // across both passes.
+        bindless.bind(command_buffer, pipeline_layout);
+        lighting.bind(command_buffer, pipeline_layout, current_frame);
+        streamer.bind(command_buffer, pipeline_layout, current_frame);
+
+        if (depth_prepass) {
+            GpuScope prepass(gpu_profiler, command_buffer, "depth pre-pass");
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depth_pipeline);
+            if (!in_pass && draw_list.empty())
+                vkCmdDraw(command_buffer, 3, 1, 0, 0);
+            record_draw_list(command_buffer, true);
+        }
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+        if (in_pass)
+            in_pass(command_buffer);
+        else if (draw_list.empty())
+            vkCmdDraw(command_buffer, 3, 1, 0, 0);
+        record_draw_list(command_buffer);
+
+        end_main_pass(command_buffer, image_index);
+    }
+    if (streamer.enabled()) streamer.finish(command_buffer, current_frame);
+    frame_capture.record(command_buffer, swapchain_images[image_index],
+                         headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+// With dynamic rendering the layout transitions the render pass used to do
+// are explicit barriers around vkCmdBeginRendering.
+void Renderer::begin_main_pass(VkCommandBuffer command_buffer, uint32_t image_index) {
+    VkClearValue clearValues[2]{};
+    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {0.0f, 0};
+
+    if (!dynamic_rendering) {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = render_pass;
-        renderPassInfo.framebuffer = swapchain_framebuffers[i];
+        renderPassInfo.framebuffer = swapchain_framebuffers[image_index];
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapchain_extent;
+        renderPassInfo.clearValueCount = 2;
+        renderPassInfo.pClearValues = clearValues;
 
-        VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        vkCmdBeginRenderPass(command_buffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
 
-        vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-        vkCmdDraw(command_buffers[i], 3, 1, 0, 0);
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencilComponent(depth_format)) depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    bool multisampled = msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+    VkImageMemoryBarrier barriers[3]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = swapchain_images[image_index];
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    // The previous frame's depth tests must finish before the clear.
+    barriers[1] = barriers[0];
+    barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[1].image = depth_image;
+    barriers[1].subresourceRange = {depthAspect, 0, 1, 0, 1};
+    barriers[2] = barriers[0];
+    barriers[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[2].image = msaa_image;
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                         0, 0, nullptr, 0, nullptr, multisampled ? 3 : 2, barriers);
+
+    VkRenderingAttachmentInfoKHR colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageView = swapchain_image_views[image_index];
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearValues[0];
+    if (multisampled) {
+        colorAttachment.imageView = msaa_view;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+        colorAttachment.resolveImageView = swapchain_image_views[image_index];
+        colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
 
-        vkCmdEndRenderPass(command_buffers[i]);
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = depth_view;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = clearValues[1];
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.extent = swapchain_extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    if (hasStencilComponent(depth_format)) renderingInfo.pStencilAttachment = &depthAttachment;
+    cmd_begin_rendering(command_buffer, &renderingInfo);
+}
 
-        if (vkEndCommandBuffer(command_buffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
-        }
+void Renderer::end_main_pass(VkCommandBuffer command_buffer, uint32_t image_index) {
+    if (!dynamic_rendering) {
+        vkCmdEndRenderPass(command_buffer);
+        return;
     }
+    cmd_end_rendering(command_buffer);
+
+    // Same final layout the legacy render pass ends in. The destination
+    // stage lets a following capture barrier chain onto the transition.
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = swapchain_images[image_index];
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
+// Binary semaphores remain only for the swapchain; frame completion is
+// tracked on the graphics queue's timeline.
 void Renderer::create_sync_objects() {
+    image_available_semaphores.resize(rune::MAX_FRAMES_IN_FLIGHT);
+    render_finished_semaphores.resize(rune::MAX_FRAMES_IN_FLIGHT);
+    frame_timeline_values.assign(rune::MAX_FRAMES_IN_FLIGHT, 0);
+
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &image_available_semaphore) != VK_SUCCESS ||
-        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &render_finished_semaphore) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create semaphores!");
+    for (size_t i = 0; i < rune::MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, host_allocator(), &image_available_semaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &semaphoreInfo, host_allocator(), &render_finished_semaphores[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sync objects!");
+        }
     }
+    graphics_timeline.init(device, graphics_queue, timeline_supported);
+    compute_timeline.init(device, compute_queue, timeline_supported);
+    transfer_timeline.init(device, transfer_queue, timeline_supported);
+}
+
+void Renderer::create_descriptor_allocators() {
+    frame_descriptors.resize(rune::MAX_FRAMES_IN_FLIGHT);
+    for (auto& allocator : frame_descriptors) allocator.init(device);
+    layout_cache.init(device);
+    pipeline_layout_cache.init(device);
+}
+
+VkPipelineLayout Renderer::reflect_pipeline_layout(const std::vector<ShaderReflection>& stages) {
+    std::vector<std::pair<uint32_t, VkDescriptorSetLayout>> fixedSets;
+    if (bindless.enabled()) fixedSets.push_back({0, bindless.layout()});
+    if (lighting.enabled()) fixedSets.push_back({ClusteredLighting::SET, lighting.layout()});
+    if (streamer.enabled()) fixedSets.push_back({TextureStreamer::SET, streamer.layout()});
+    VkPushConstantRange pushRange = push_constant_range<BindlessPush>(BINDLESS_PUSH_STAGES);
+    return build_pipeline_layout(stages, layout_cache, pipeline_layout_cache, fixedSets, {pushRange});
+}
+
+VkDescriptorSet Renderer::allocate_frame_set(VkDescriptorSetLayout layout) {
+    return frame_descriptors[current_frame].allocate(layout);
+}
+
+void Renderer::wait_for_frame(uint64_t value) {
+    graphics_timeline.wait(device, value);
+}
+
+uint64_t Renderer::submit_transfer(const std::function<void(VkCommandBuffer)>& record) {
+    while (!pending_transfers.empty() && transfer_timeline.is_complete(device, pending_transfers.front().first)) {
+        vkFreeCommandBuffers(device, transfer_command_pool, 1, &pending_transfers.front().second);
+        pending_transfers.pop_front();
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = transfer_command_pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate transfer command buffer!");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin recording transfer command buffer!");
+    record(commandBuffer);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record transfer command buffer!");
+
+    TimelineSubmit submit;
+    submit.command_buffer = commandBuffer;
+    uint64_t value = transfer_timeline.submit(device, submit);
+    pending_transfers.push_back({value, commandBuffer});
+    return value;
+}
+
+void Renderer::graphics_wait(QueueTimeline& timeline, uint64_t value, VkPipelineStageFlags stage) {
+    pending_graphics_waits.emplace_back(&timeline, value, stage);
 }
 
 void Renderer::device_wait_idle() {
     vkDeviceWaitIdle(device);
 }
 
+// ---------------- resources ----------------
+BufferHandle Renderer::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    MemoryCategory category = MemoryCategory::OTHER;
+    if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+        category = MemoryCategory::MESHES;
+    else if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+        category = MemoryCategory::STAGING;
+
+    VulkanBuffer buffer;
+    buffer.track(&memory_budget, category);
+    if (!buffer.init(physical_device, device, size, usage, properties)) {
+        buffer.deinit(device);
+        throw std::runtime_error("failed to create buffer!");
+    }
+    return buffers.insert(buffer);
+}
+
+PipelineHandle Renderer::create_pipeline(const std::vector<char>& vertCode, const std::vector<char>& fragCode) {
+    ShaderReflection vertReflection = reflect_spirv(vertCode);
+    VkShaderModule vertModule = create_shader_module(vertCode);
+    VkShaderModule fragModule = create_shader_module(fragCode);
+
+    if (depth_prepass && !vertReflection.invariant_position)
+        throw std::runtime_error("vertex shader must declare gl_Position invariant for the depth pre-pass!");
+
+    GpuPipeline pipeline;
+    pipeline.layout = reflect_pipeline_layout({vertReflection, reflect_spirv(fragCode)});
+    pipeline.pipeline = build_graphics_pipeline(vertModule, fragModule, &vertReflection, pipeline.layout);
+    if (depth_prepass) pipeline.depth_pipeline = build_depth_pipeline(vertModule, &vertReflection, pipeline.layout);
+
+    vkDestroyShaderModule(device, fragModule, host_allocator());
+    vkDestroyShaderModule(device, vertModule, host_allocator());
+    return pipelines.insert(pipeline);
+}
+
+SamplerHandle Renderer::create_sampler(const VkSamplerCreateInfo& info) {
+    GpuSampler sampler;
+    if (vkCreateSampler(device, &info, host_allocator(), &sampler.sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create sampler!");
+    return samplers.insert(sampler);
+}
+
+ImageHandle Renderer::create_texture(const void* pixels, VkDeviceSize size, uint32_t width, uint32_t height,
+                                     VkFormat format, bool mipmaps) {
+    return create_texture(pixels, std::vector<VkDeviceSize>{size}, width, height, format, mipmaps);
+}
+
+ImageHandle Renderer::create_texture(const void* data, const std::vector<VkDeviceSize>& level_sizes, uint32_t width,
+                                     uint32_t height, VkFormat format, bool generate_mips) {
+    std::vector<VkDeviceSize> levelOffsets;
+    VkDeviceSize stagingSize = pack_staging_levels(level_sizes, levelOffsets);
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer staging;
+    if (vkCreateBuffer(device, &bufferInfo, host_allocator(), &staging) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture staging buffer!");
+    GpuAllocation stagingMemory = allocator.allocate_buffer(
+        staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::STAGING);
+    const char* src = static_cast<const char*>(data);
+    for (size_t i = 0; i < level_sizes.size(); i++) {
+        std::memcpy(static_cast<char*>(stagingMemory.mapped) + levelOffsets[i], src, level_sizes[i]);
+        src += level_sizes[i];
+    }
+
+    GpuImage texture;
+    texture.format = format;
+    texture.extent = {width, height, 1};
+    texture.mip_levels = static_cast<uint32_t>(level_sizes.size());
+    if (generate_mips && supports_mip_blit(physical_device, format))
+        texture.mip_levels = std::max(texture.mip_levels, mip_count(width, height));
+
+    VkImageCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = format;
+    info.extent = texture.extent;
+    info.mipLevels = texture.mip_levels;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (texture.mip_levels > level_sizes.size()) info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &info, host_allocator(), &texture.image) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture image!");
+    texture.allocation = allocator.allocate_image(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::TEXTURES);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mip_levels, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, host_allocator(), &texture.view) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture image view!");
+
+    // The upload is recorded ahead of any draw that could sample the slot.
+    if (bindless.enabled())
+        texture.bindless_index = bindless.add_texture(device, texture.view, get_sampler(default_sampler_info()));
+
+    pending_uploads.push_back({texture.image, staging, std::move(levelOffsets), {width, height}, texture.mip_levels});
+    pending_staging.emplace_back(staging, stagingMemory);
+    return images.insert(texture);
+}
+
+ImageHandle Renderer::load_texture(const std::string& path) {
+    TextureAsset asset = read_texture_asset(path);
+
+    VkFormat compressed = codec_format(asset.codec, asset.srgb);
+    VkFormat fallback = codec_format(BlockCodec::RGBA8, asset.srgb);
+    VkFormat format = find_supported_format({compressed, fallback}, VK_IMAGE_TILING_OPTIMAL,
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+    if (format != compressed) {
+        std::cout << "texture: decoding " << path << " to RGBA8, block format not supported" << std::endl;
+        for (size_t i = 0; i < asset.levels.size(); i++) {
+            uint32_t w = std::max(asset.width >> i, 1u);
+            uint32_t h = std::max(asset.height >> i, 1u);
+            asset.levels[i] = decode_image(asset.codec, asset.levels[i].data(), w, h);
+        }
+    }
+
+    std::vector<VkDeviceSize> levelSizes;
+    std::vector<uint8_t> packed;
+    for (const std::vector<uint8_t>& level : asset.levels) {
+        levelSizes.push_back(level.size());
+        packed.insert(packed.end(), level.begin(), level.end());
+    }
+    return create_texture(packed.data(), levelSizes, asset.width, asset.height, format, false);
+}
+
+uint32_t Renderer::stream_texture(const std::string& path) {
+    if (!streamer.enabled()) throw std::runtime_error("texture streaming is not enabled!");
+    return streamer.add(path);
+}
+
+VkSampler Renderer::get_sampler(const VkSamplerCreateInfo& info) {
+    return sampler_cache.get(info);
+}
+
+ImageHandle Renderer::add_image(const GpuImage& image) {
+    return images.insert(image);
+}
+
+void Renderer::destroy(BufferHandle handle) {
+    VulkanBuffer buffer;
+    if (buffers.remove(handle, &buffer))
+        buffer.retire(deletion_queue, graphics_timeline.submitted() + 1);
+}
+
+void Renderer::destroy(ImageHandle handle) {
+    GpuImage image;
+    if (!images.remove(handle, &image)) return;
+    if (image.bindless_index != UINT32_MAX)
+        bindless.remove_texture(image.bindless_index, graphics_timeline.submitted() + 1);
+    retire(image.view);
+    retire(image.image);
+    if (image.allocation)
+        allocator.free(image.allocation, graphics_timeline.submitted() + 1);
+    else
+        retire(image.memory);
+}
+
+void Renderer::destroy(PipelineHandle handle) {
+    GpuPipeline pipeline;
+    if (!pipelines.remove(handle, &pipeline)) return;
+    retire(pipeline.pipeline);
+    if (pipeline.depth_pipeline) retire(pipeline.depth_pipeline);
+}
+
+void Renderer::destroy(SamplerHandle handle) {
+    GpuSampler sampler;
+    if (samplers.remove(handle, &sampler)) retire(sampler.sampler);
+}
+
+// Binds only what changes between consecutive records, so sorting the list
+// by pipeline and buffers first keeps the command stream short. Stale
+// handles are skipped.
+void Renderer::record_draw_list(VkCommandBuffer command_buffer, bool depthOnly) {
+    PipelineHandle boundPipeline;
+    BufferHandle boundVertices;
+    BufferHandle boundIndices;
+    VkPipelineLayout layout = pipeline_layout;
+    BindlessPush pushed;
+    bool hasPushed = false;
+
+    for (const DrawRecord& draw : draw_list) {
+        if (draw.pipeline && draw.pipeline != boundPipeline) {
+            GpuPipeline* pipeline = pipelines.get(draw.pipeline);
+            if (!pipeline) continue;
+            vkCmdBindPipeline(command_buffer, pipeline->bind_point, depthOnly ? pipeline->depth_pipeline : pipeline->pipeline);
+            boundPipeline = draw.pipeline;
+            layout = pipeline->layout;
+        }
+        if (draw.vertex_buffer && draw.vertex_buffer != boundVertices) {
+            VulkanBuffer* buffer = buffers.get(draw.vertex_buffer);
+            if (!buffer) continue;
+            VkBuffer vertexBuffer = buffer->get_buffer();
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertexBuffer, &offset);
+            boundVertices = draw.vertex_buffer;
+        }
+        if (!hasPushed || std::memcmp(&pushed, &draw.indices, sizeof(BindlessPush)) != 0) {
+            push_constants(command_buffer, layout, BINDLESS_PUSH_STAGES, draw.indices);
+            pushed = draw.indices;
+            hasPushed = true;
+        }
+
+        if (!draw.index_buffer) {
+            vkCmdDraw(command_buffer, draw.count, draw.instance_count, draw.first, draw.first_instance);
+            continue;
+        }
+        if (draw.index_buffer != boundIndices) {
+            VulkanBuffer* buffer = buffers.get(draw.index_buffer);
+            if (!buffer) continue;
+            vkCmdBindIndexBuffer(command_buffer, buffer->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+            boundIndices = draw.index_buffer;
+        }
+        vkCmdDrawIndexed(command_buffer, draw.count, draw.instance_count, draw.first, draw.vertex_offset, draw.first_instance);
+    }
+    if (!depthOnly) draw_list.clear();
+}
+
 // ---------------- drawing ----------------
 void Renderer::draw() {
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, &imageIndex);
+    PROFILE_ZONE("draw");
+    {
+        PROFILE_ZONE("wait for frame");
+        graphics_timeline.wait(device, frame_timeline_values[current_frame]);
+    }
+    uint64_t completed = graphics_timeline.completed(device);
+    deletion_queue.collect(device, completed);
+    allocator.collect(completed);
+    bindless.collect(completed);
+    frame_descriptors[current_frame].reset();
+    frame_capture.begin_frame(device, current_frame);
+    memory_budget.update();
+    host_allocation_counters();
+    if (streamer.enabled()) {
+        streamer.collect(completed);
+        streamer.begin_frame(current_frame);
+    }
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    // Offscreen targets are per frame in flight, so there is nothing to acquire.
+    uint32_t imageIndex = current_frame;
+    if (!headless) {
+        PROFILE_ZONE("acquire");
+        vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &imageIndex);
+    }
 
-    VkSemaphore waitSemaphores[] = {image_available_semaphore};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    VkCommandBuffer commandBuffer = command_buffers[current_frame];
+    {
+        PROFILE_ZONE("record");
+        vkResetCommandBuffer(commandBuffer, 0);
+        record_command_buffer(commandBuffer, imageIndex);
+    }
+
+    TimelineSubmit submit;
+    submit.command_buffer = commandBuffer;
+
+    // Submitted first so the compute queue can start while graphics is still
+    // busy with the previous frame. Reusing this slot's buffer is safe: the
+    // graphics value waited on above waited for it.
+    if (async_compute) {
+        PROFILE_ZONE("async compute");
+        VkCommandBuffer computeBuffer = compute_command_buffers[current_frame];
+        vkResetCommandBuffer(computeBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(computeBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to begin recording compute command buffer!");
+        async_compute(computeBuffer);
+        if (vkEndCommandBuffer(computeBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to record compute command buffer!");
+
+        TimelineSubmit computeSubmit;
+        computeSubmit.command_buffer = computeBuffer;
+        submit.wait(compute_timeline, compute_timeline.submit(device, computeSubmit), compute_wait_stage);
+    }
+    for (auto& [timeline, value, stage] : pending_graphics_waits)
+        submit.wait(*timeline, value, stage);
+    pending_graphics_waits.clear();
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &command_buffers[imageIndex];
+    if (!headless) {
+        submit.wait_binary(image_available_semaphores[current_frame], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        submit.signal_binary(render_finished_semaphores[current_frame]);
+    }
 
-    VkSemaphore signalSemaphores[] = {render_finished_semaphore};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    {
+        PROFILE_ZONE("submit");
+        frame_timeline_values[current_frame] = graphics_timeline.submit(device, submit);
+    }
 
-    if (vkQueueSubmit(graphics_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    if (headless) {
+        current_frame = (current_frame + 1) % rune::MAX_FRAMES_IN_FLIGHT;
+        return;
     }
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &render_finished_semaphores[current_frame];
 
     VkSwapchainKHR swapchains[] = {swapchain};
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapchains;
     presentInfo.pImageIndices = &imageIndex;
 
-    vkQueuePresentKHR(present_queue, &presentInfo);
-}
\ No newline at end of file
+    {
+        PROFILE_ZONE("present");
+        vkQueuePresentKHR(present_queue, &presentInfo);
+    }
+
+    current_frame = (current_frame + 1) % rune::MAX_FRAMES_IN_FLIGHT;
+}
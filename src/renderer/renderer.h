@@ -1,6 +1,20 @@
 #pragma once
 
 #include "../window.h"
+#include "gpu_profiler.h"
+#include "frame_capture.h"
+#include "timeline.h"
+#include "queue_transfer.h"
+#include "deletion_queue.h"
+#include "resources.h"
+#include "bindless.h"
+#include "descriptors.h"
+#include "render_graph.h"
+#include "lighting.h"
+#include "texture.h"
+#include "texture_streaming.h"
+#include "memory_budget.h"
+#include "spirv_reflect.h"
 
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
@@ -10,33 +24,150 @@
 #include <optional>
 #include <set>
 #include <fstream>
+#include <functional>
+#include <deque>
+#include <tuple>
 
 
 struct Renderer {
     Window* window;
     VkInstance instance;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     VkPhysicalDevice physical_device = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue graphics_queue;
     VkQueue present_queue;
+    // Async queues. On devices without dedicated families these are the
+    // graphics queue again; the timelines and pools stay separate either way.
+    VkQueue compute_queue;
+    VkQueue transfer_queue;
+    uint32_t graphics_family = 0;
+    uint32_t compute_family = 0;
+    uint32_t transfer_family = 0;
     VkSwapchainKHR swapchain;
     std::vector<VkImage> swapchain_images;
     VkFormat swapchain_image_format;
     VkExtent2D swapchain_extent;
     std::vector<VkImageView> swapchain_image_views;
+    // Main pass depth, reversed-Z: cleared to 0 with nearer fragments
+    // greater, which spreads float precision evenly over distance.
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    VkImage depth_image = VK_NULL_HANDLE;
+    VkDeviceMemory depth_memory = VK_NULL_HANDLE;
+    VkImageView depth_view = VK_NULL_HANDLE;
+    // Requested before init, clamped to 8x and to what the device supports
+    // for color and depth. Above 1x the main pass renders into transient
+    // multisampled targets and resolves into the swapchain image in-pass.
+    VkSampleCountFlagBits msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImage msaa_image = VK_NULL_HANDLE;
+    VkDeviceMemory msaa_memory = VK_NULL_HANDLE;
+    VkImageView msaa_view = VK_NULL_HANDLE;
+    // Set before init. Lays down depth for the draw list (and default
+    // triangle) with depth-only pipelines first; shading pipelines then test
+    // EQUAL without writing, so each pixel is shaded about once. in_pass
+    // draws get no pre-pass and need their own depth (build_depth_pipeline).
+    // Vertex shaders must declare `invariant gl_Position;` for EQUAL to hold.
+    bool depth_prepass = false;
     VkRenderPass render_pass;
     VkPipelineLayout pipeline_layout;
     VkPipeline graphics_pipeline;
+    VkPipeline depth_pipeline = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> swapchain_framebuffers;
     VkCommandPool command_pool;
     std::vector<VkCommandBuffer> command_buffers;
-    VkSemaphore image_available_semaphore;
-    VkSemaphore render_finished_semaphore;
-    VkDescriptorSetLayout descriptor_set_layout;
+    VkCommandPool compute_command_pool;
+    std::vector<VkCommandBuffer> compute_command_buffers;
+    VkCommandPool transfer_command_pool;
+    // One-shot transfer command buffers, freed once their value completes.
+    std::deque<std::pair<uint64_t, VkCommandBuffer>> pending_transfers;
+    std::vector<VkSemaphore> image_available_semaphores;
+    std::vector<VkSemaphore> render_finished_semaphores;
+    uint32_t instance_version = VK_API_VERSION_1_0;
+    bool timeline_supported = false;
+    QueueTimeline graphics_timeline;
+    QueueTimeline compute_timeline;
+    QueueTimeline transfer_timeline;
+    // Objects retired against graphics_timeline, freed at the top of draw().
+    DeletionQueue deletion_queue;
+    // Pooled resources, addressed by generational handles. Destroying one
+    // retires it to deletion_queue, so it is safe while frames are in flight.
+    ResourcePool<VulkanBuffer, BufferTag> buffers;
+    ResourcePool<GpuImage, ImageTag> images;
+    ResourcePool<GpuPipeline, PipelineTag> pipelines;
+    ResourcePool<GpuSampler, SamplerTag> samplers;
+    // Shared device memory for textures and staging; frees are deferred on
+    // graphics_timeline like deletion_queue.
+    GpuAllocator allocator;
+    // Device memory per heap and category, refreshed once per frame. Add
+    // eviction or downgrade hooks with memory_budget.on_pressure().
+    MemoryBudget memory_budget;
+    bool memory_budget_supported = false;
+    SamplerCache sampler_cache;
+    // Textures created since the last frame was recorded, uploaded as one
+    // batch at the start of the next one. Staging is retired after it.
+    std::vector<TextureUpload> pending_uploads;
+    std::vector<std::pair<VkBuffer, GpuAllocation>> pending_staging;
+    // Recorded into the main pass each frame, then cleared.
+    std::vector<DrawRecord> draw_list;
+    // Extra waits for the next graphics submit, see graphics_wait().
+    std::vector<std::tuple<QueueTimeline*, uint64_t, VkPipelineStageFlags>> pending_graphics_waits;
+    // Graphics timeline value signaled by each frame-in-flight slot's last submit.
+    std::vector<uint64_t> frame_timeline_values;
+    uint32_t current_frame = 0;
+    bool headless = false;
+    std::vector<VkDeviceMemory> offscreen_memory;
+    // Set 0 of pipeline_layout when the device has descriptor indexing.
+    bool bindless_supported = false;
+    // VK_KHR_dynamic_rendering: passes begin on image views directly, with
+    // no VkRenderPass/VkFramebuffer. Clear allow_dynamic_rendering before
+    // init to force the legacy render pass path.
+    bool allow_dynamic_rendering = true;
+    bool dynamic_rendering = false;
+    PFN_vkCmdBeginRenderingKHR cmd_begin_rendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmd_end_rendering = nullptr;
+    BindlessHeap bindless;
+    // Non-bindless path: per-frame descriptor sets, recycled wholesale when
+    // the frame slot comes around again, and deduplicated set layouts.
+    std::vector<DescriptorAllocator> frame_descriptors;
+    DescriptorLayoutCache layout_cache;
+    PipelineLayoutCache pipeline_layout_cache;
+    // Set before init to bin `lighting.lights` every frame and bind the
+    // lighting set at ClusteredLighting::SET of pipeline_layout. The main
+    // pipeline then draws with lit.vert/lit.frag instead of tri.vert/tri.frag.
+    // Their .spv and cluster_lights.comp.spv come from make shaders (glslc).
+    bool clustered_lighting = false;
+    ClusteredLighting lighting;
+    // Set before init to stream textures added with stream_texture() and
+    // bind the streaming set at TextureStreamer::SET. Needs bindless. No
+    // built-in shader samples streamed textures; the application's fragment
+    // shaders include streaming.glsl and call sample_streamed().
+    bool texture_streaming = false;
+    TextureStreamer streamer;
+    GpuProfiler gpu_profiler;
+    FrameCapture frame_capture;
+    bool capture_supported = false;
+    // Optional; frame captures are encoded on it instead of the render thread.
+    JobSystem* jobs = nullptr;
+
+    // Optional per-frame recording callbacks for tools and benchmarks.
+    // pre_pass runs before the main render pass, in_pass inside it with the
+    // default pipeline bound; without in_pass the default triangle is drawn.
+    std::function<void(VkCommandBuffer)> pre_pass;
+    std::function<void(VkCommandBuffer)> in_pass;
+    // Optional frame graph, executed after pre_pass and before the main
+    // pass. Compiled on first use; recompiled after passes change.
+    RenderGraph graph;
+    // Optional async compute work, recorded per frame on the compute queue
+    // and submitted ahead of the graphics work, which waits for it only at
+    // compute_wait_stage. It must not write anything the previous frame's
+    // graphics work may still read; hand resources over with the
+    // queue_transfer.h helpers.
+    std::function<void(VkCommandBuffer)> async_compute;
+    VkPipelineStageFlags compute_wait_stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
 
     // --- core ---
     void init_renderer(Window* wind);
+    void init_headless();
     void init_vulkan();
     void deinit();
 
@@ -48,16 +179,91 @@ struct Renderer {
     void create_logical_device();
     void create_swapchain();
     void create_image_views();
+    void create_offscreen_targets();
+    VkFormat find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+    void create_attachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                           VkImage& image, VkDeviceMemory& memory, VkImageView& view);
+    void create_depth_resources();
     void create_renderpass();
     void create_graphics_pipeline();
+    // Vertex inputs come from `vertex` (none without it), packed in binding
+    // 0; a null layout means pipeline_layout.
+    VkPipeline build_graphics_pipeline(VkShaderModule vertModule, VkShaderModule fragModule,
+                                       const ShaderReflection* vertex = nullptr, VkPipelineLayout layout = VK_NULL_HANDLE);
+    // Vertex stage only, no color writes; for the depth pre-pass.
+    VkPipeline build_depth_pipeline(VkShaderModule vertModule, const ShaderReflection* vertex = nullptr,
+                                    VkPipelineLayout layout = VK_NULL_HANDLE);
     void create_framebuffers();
     void create_command_pool();
     // void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
     void create_command_buffers();
     void create_sync_objects();
+    void create_descriptor_allocators();
+    void record_command_buffer(VkCommandBuffer command_buffer, uint32_t image_index);
+    void begin_main_pass(VkCommandBuffer command_buffer, uint32_t image_index);
+    void end_main_pass(VkCommandBuffer command_buffer, uint32_t image_index);
 
     void device_wait_idle();
+    // Blocks until graphics_timeline reaches `value` (e.g. a value returned
+    // by graphics_timeline.submitted() when a frame was submitted).
+    void wait_for_frame(uint64_t value);
     void draw();
+    // Records `record` into a one-shot command buffer on the transfer queue
+    // and submits it right away. Returns its transfer_timeline value.
+    uint64_t submit_transfer(const std::function<void(VkCommandBuffer)>& record);
+    // Destroys `handle` once every graphics submit that may have used it has
+    // finished, including the frame currently being recorded.
+    template <typename T>
+    void retire(T handle) { deletion_queue.retire(graphics_timeline.submitted() + 1, handle); }
+    // Makes the next graphics submit wait for `value` on `timeline` at `stage`.
+    void graphics_wait(QueueTimeline& timeline, uint64_t value, VkPipelineStageFlags stage);
+    void capture(const std::string& path);
+
+    // --- resources ---
+    BufferHandle create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    // Layout and vertex inputs are reflected from the SPIR-V; the layout
+    // belongs to pipeline_layout_cache and is shared, never destroyed here.
+    PipelineHandle create_pipeline(const std::vector<char>& vertCode, const std::vector<char>& fragCode);
+    SamplerHandle create_sampler(const VkSamplerCreateInfo& info);
+    // Sampled texture from `size` bytes of level 0 pixels. The pixels are
+    // copied to staging right away; the copy and, with `mipmaps`, the GPU
+    // mip chain are recorded at the start of the next frame together with
+    // every other pending texture. Mips are skipped when the format cannot
+    // be blitted. With bindless, the texture also gets a slot in the texture
+    // array (GpuImage::bindless_index) with default_sampler_info().
+    ImageHandle create_texture(const void* pixels, VkDeviceSize size, uint32_t width, uint32_t height,
+                               VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, bool mipmaps = true);
+    // Precomputed levels, largest first and packed back to back in `data`,
+    // one entry of `level_sizes` each. With `generate_mips` the levels below
+    // them are blitted as above.
+    ImageHandle create_texture(const void* data, const std::vector<VkDeviceSize>& level_sizes, uint32_t width,
+                               uint32_t height, VkFormat format, bool generate_mips);
+    // Baked .rtex texture in its block-compressed format, or decoded to
+    // RGBA8 on the CPU when the device cannot sample that format.
+    ImageHandle load_texture(const std::string& path);
+    // Baked .rtex texture whose finer mips stream in on demand; returns the
+    // id shaders pass to sample_streamed(). Needs texture_streaming.
+    uint32_t stream_texture(const std::string& path);
+    // Shared, deduplicated sampler; owned by sampler_cache, never destroyed.
+    VkSampler get_sampler(const VkSamplerCreateInfo& info);
+    // Takes ownership of an image created elsewhere.
+    ImageHandle add_image(const GpuImage& image);
+    void destroy(BufferHandle handle);
+    void destroy(ImageHandle handle);
+    void destroy(PipelineHandle handle);
+    void destroy(SamplerHandle handle);
+    // depthOnly records the pre-pass with the depth pipelines, and keeps the
+    // list for the shading pass.
+    void record_draw_list(VkCommandBuffer command_buffer, bool depthOnly = false);
+    // Pipeline layout built from reflected shaders, shared with every other
+    // pipeline that has the same interface. The engine's sets (bindless,
+    // lighting, streaming) are fixed at their slots when enabled, and the
+    // push range is always BindlessPush for vertex and fragment, matching
+    // record_draw_list. Owned by pipeline_layout_cache.
+    VkPipelineLayout reflect_pipeline_layout(const std::vector<ShaderReflection>& stages);
+    // A set valid until this frame slot is next reused; never free it. The
+    // lighting and streaming sets come from here every frame.
+    VkDescriptorSet allocate_frame_set(VkDescriptorSetLayout layout);
 
     // --- helpers ---
     VkShaderModule create_shader_module(const std::vector<char>& code);
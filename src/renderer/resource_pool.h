@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// 32-bit generational handle: the low INDEX_BITS are a slot in the pool,
+// the rest is the slot's generation when the handle was made. Generations
+// start at 1, so a zero handle is never valid. `Tag` only keeps buffer,
+// image, ... handles from converting into each other.
+template <typename Tag>
+struct Handle {
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t bits = 0;
+
+    uint32_t index() const { return bits & INDEX_MASK; }
+    uint32_t generation() const { return bits >> INDEX_BITS; }
+    bool is_null() const { return bits == 0; }
+    explicit operator bool() const { return bits != 0; }
+    bool operator==(const Handle&) const = default;
+
+    static Handle make(uint32_t index, uint32_t generation) { return {(generation << INDEX_BITS) | index}; }
+};
+
+// Dense slot array with a free list. Lookups are an index plus one compare;
+// removed slots are reused with a bumped generation so handles to the old
+// occupant fail get(). Generations wrap after 4095 reuses of one slot,
+// skipping 0. Holds at most 2^INDEX_BITS live slots; insert() throws past
+// that. Not thread-safe.
+template <typename T, typename Tag>
+struct ResourcePool {
+    using HandleType = Handle<Tag>;
+
+    HandleType insert(const T& value) {
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+            m_items[index] = value;
+        } else {
+            index = static_cast<uint32_t>(m_items.size());
+            // Any further index would spill into the generation bits.
+            if (index > HandleType::INDEX_MASK) throw std::runtime_error("resource pool is full!");
+            m_items.push_back(value);
+            m_generations.push_back(1);
+            m_alive.push_back(false);
+        }
+        m_alive[index] = true;
+        m_count++;
+        return HandleType::make(index, m_generations[index]);
+    }
+
+    // nullptr for null, stale or removed handles.
+    T* get(HandleType handle) {
+        uint32_t index = handle.index();
+        if (index >= m_items.size() || !m_alive[index] || m_generations[index] != handle.generation()) return nullptr;
+        return &m_items[index];
+    }
+
+    // Copies the removed value to `out` so the caller can destroy it.
+    bool remove(HandleType handle, T* out = nullptr) {
+        T* item = get(handle);
+        if (!item) return false;
+        if (out) *out = *item;
+
+        uint32_t index = handle.index();
+        m_alive[index] = false;
+        m_generations[index] = (m_generations[index] + 1) & HandleType::GENERATION_MASK;
+        if (m_generations[index] == 0) m_generations[index] = 1;
+        m_free.push_back(index);
+        m_count--;
+        return true;
+    }
+
+    // Calls fn(handle, value) for every live slot.
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+        for (uint32_t i = 0; i < m_items.size(); i++)
+            if (m_alive[i]) fn(HandleType::make(i, m_generations[i]), m_items[i]);
+    }
+
+    uint32_t size() const { return m_count; }
+
+    private:
+    std::vector<T> m_items;
+    std::vector<uint16_t> m_generations;
+    std::vector<bool> m_alive;
+    std::vector<uint32_t> m_free;
+    uint32_t m_count = 0;
+};
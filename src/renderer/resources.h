@@ -0,0 +1,59 @@
+#pragma once
+
+#include "resource_pool.h"
+#include "buffer.h"
+#include "bindless.h"
+#include "allocator.h"
+
+#include <vulkan/vulkan.h>
+#include <type_traits>
+
+using BufferHandle = Handle<struct BufferTag>;
+using ImageHandle = Handle<struct ImageTag>;
+using PipelineHandle = Handle<struct PipelineTag>;
+using SamplerHandle = Handle<struct SamplerTag>;
+
+struct GpuImage {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    // Dedicated memory, or null when the image lives in `allocation`.
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    GpuAllocation allocation;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {0, 0, 0};
+    uint32_t mip_levels = 1;
+    // Slot in the bindless texture array, UINT32_MAX if it has none.
+    uint32_t bindless_index = UINT32_MAX;
+};
+
+struct GpuPipeline {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    // Depth pre-pass variant, when Renderer::depth_prepass is set.
+    VkPipeline depth_pipeline = VK_NULL_HANDLE;
+};
+
+struct GpuSampler {
+    VkSampler sampler = VK_NULL_HANDLE;
+};
+
+// One entry of the renderer's draw list. Handles instead of Vulkan objects
+// keep it at 48 bytes of plain data; `indices` is pushed as the draw's
+// push constants when it differs from the previous record. A null pipeline
+// or vertex_buffer keeps whatever is bound; a null index_buffer means a
+// non-indexed draw of `count` vertices.
+struct DrawRecord {
+    PipelineHandle pipeline;
+    BufferHandle vertex_buffer;
+    BufferHandle index_buffer;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t instance_count = 1;
+    uint32_t first_instance = 0;
+    int32_t vertex_offset = 0;
+    BindlessPush indices;
+};
+
+static_assert(std::is_trivially_copyable_v<DrawRecord>, "draw records are copied around as plain data");
+static_assert(sizeof(DrawRecord) == 48, "keep draw records packed");
@@ -0,0 +1,400 @@
+#include "spirv_reflect.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+// Only the handful of opcodes and enums reflection looks at; the numbers
+// come from the SPIR-V specification.
+namespace spv {
+    const uint32_t MAGIC = 0x07230203;
+
+    const uint32_t OP_ENTRY_POINT = 15;
+    const uint32_t OP_TYPE_BOOL = 20;
+    const uint32_t OP_TYPE_INT = 21;
+    const uint32_t OP_TYPE_FLOAT = 22;
+    const uint32_t OP_TYPE_VECTOR = 23;
+    const uint32_t OP_TYPE_MATRIX = 24;
+    const uint32_t OP_TYPE_IMAGE = 25;
+    const uint32_t OP_TYPE_SAMPLER = 26;
+    const uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+    const uint32_t OP_TYPE_ARRAY = 28;
+    const uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+    const uint32_t OP_TYPE_STRUCT = 30;
+    const uint32_t OP_TYPE_POINTER = 32;
+    const uint32_t OP_CONSTANT = 43;
+    const uint32_t OP_VARIABLE = 59;
+    const uint32_t OP_DECORATE = 71;
+    const uint32_t OP_MEMBER_DECORATE = 72;
+
+    const uint32_t DECORATION_BLOCK = 2;
+    const uint32_t DECORATION_BUFFER_BLOCK = 3;
+    const uint32_t DECORATION_ARRAY_STRIDE = 6;
+    const uint32_t DECORATION_MATRIX_STRIDE = 7;
+    const uint32_t DECORATION_BUILT_IN = 11;
+    const uint32_t DECORATION_INVARIANT = 18;
+    const uint32_t DECORATION_LOCATION = 30;
+    const uint32_t DECORATION_BINDING = 33;
+    const uint32_t DECORATION_DESCRIPTOR_SET = 34;
+    const uint32_t DECORATION_OFFSET = 35;
+
+    const uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+    const uint32_t STORAGE_INPUT = 1;
+    const uint32_t STORAGE_UNIFORM = 2;
+    const uint32_t STORAGE_PUSH_CONSTANT = 9;
+    const uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+    const uint32_t BUILT_IN_POSITION = 0;
+
+    const uint32_t DIM_BUFFER = 5;
+    const uint32_t DIM_SUBPASS_DATA = 6;
+}
+
+namespace {
+    struct Type {
+        uint32_t op = 0;
+        std::vector<uint32_t> operands;
+    };
+
+    struct Module {
+        const uint32_t* words = nullptr;
+        size_t count = 0;
+        uint32_t execution_model = 0;
+        bool has_entry_point = false;
+        std::unordered_map<uint32_t, Type> types;
+        std::unordered_map<uint32_t, uint32_t> constants;
+        std::unordered_map<uint32_t, uint32_t> array_strides;
+        // (id, decoration) -> first literal, or 1 for decorations without one
+        std::unordered_map<uint64_t, uint32_t> decorations;
+        // (struct id, member) -> decoration value
+        std::unordered_map<uint64_t, uint32_t> member_offsets;
+        std::unordered_map<uint64_t, uint32_t> matrix_strides;
+        // (struct id, member) of gl_Position in the gl_PerVertex block
+        std::unordered_set<uint64_t> position_members;
+        std::unordered_set<uint64_t> invariant_members;
+        // (variable id, pointer type id, storage class)
+        struct Variable { uint32_t id, type, storage; };
+        std::vector<Variable> variables;
+    };
+
+    uint64_t member_key(uint32_t id, uint32_t member) { return (uint64_t(id) << 32) | member; }
+
+    Module parse(const std::vector<char>& code) {
+        if (code.size() < 20 || code.size() % 4 != 0) throw std::runtime_error("invalid SPIR-V module size!");
+
+        Module module;
+        module.words = reinterpret_cast<const uint32_t*>(code.data());
+        module.count = code.size() / 4;
+        if (module.words[0] != spv::MAGIC) throw std::runtime_error("invalid SPIR-V magic number!");
+
+        size_t i = 5;
+        while (i < module.count) {
+            uint32_t op = module.words[i] & 0xffff;
+            uint32_t length = module.words[i] >> 16;
+            if (length == 0 || i + length > module.count) throw std::runtime_error("malformed SPIR-V instruction!");
+            const uint32_t* w = module.words + i;
+
+            switch (op) {
+                case spv::OP_ENTRY_POINT:
+                    if (!module.has_entry_point) module.execution_model = w[1];
+                    module.has_entry_point = true;
+                    break;
+                case spv::OP_TYPE_BOOL:
+                case spv::OP_TYPE_INT:
+                case spv::OP_TYPE_FLOAT:
+                case spv::OP_TYPE_VECTOR:
+                case spv::OP_TYPE_MATRIX:
+                case spv::OP_TYPE_IMAGE:
+                case spv::OP_TYPE_SAMPLER:
+                case spv::OP_TYPE_SAMPLED_IMAGE:
+                case spv::OP_TYPE_ARRAY:
+                case spv::OP_TYPE_RUNTIME_ARRAY:
+                case spv::OP_TYPE_STRUCT:
+                case spv::OP_TYPE_POINTER:
+                    module.types[w[1]] = {op, std::vector<uint32_t>(w + 2, w + length)};
+                    break;
+                case spv::OP_CONSTANT:
+                    if (length >= 4) module.constants[w[2]] = w[3];
+                    break;
+                case spv::OP_VARIABLE:
+                    module.variables.push_back({w[2], w[1], w[3]});
+                    break;
+                case spv::OP_DECORATE:
+                    if (length >= 4 && w[2] == spv::DECORATION_ARRAY_STRIDE) module.array_strides[w[1]] = w[3];
+                    if (length >= 3) module.decorations[member_key(w[1], w[2])] = length >= 4 ? w[3] : 1;
+                    break;
+                case spv::OP_MEMBER_DECORATE:
+                    if (length >= 5 && w[3] == spv::DECORATION_OFFSET) module.member_offsets[member_key(w[1], w[2])] = w[4];
+                    if (length >= 5 && w[3] == spv::DECORATION_MATRIX_STRIDE) module.matrix_strides[member_key(w[1], w[2])] = w[4];
+                    if (length >= 5 && w[3] == spv::DECORATION_BUILT_IN && w[4] == spv::BUILT_IN_POSITION)
+                        module.position_members.insert(member_key(w[1], w[2]));
+                    if (length >= 4 && w[3] == spv::DECORATION_INVARIANT) module.invariant_members.insert(member_key(w[1], w[2]));
+                    break;
+            }
+            i += length;
+        }
+        return module;
+    }
+
+    // Size of a type as laid out in an explicitly offset block (push
+    // constants, buffers). `matrix_stride` comes from the enclosing member.
+    uint32_t type_size(const Module& module, uint32_t id, uint32_t matrix_stride = 0) {
+        auto it = module.types.find(id);
+        if (it == module.types.end()) return 0;
+        const Type& type = it->second;
+
+        switch (type.op) {
+            case spv::OP_TYPE_BOOL: return 4;
+            case spv::OP_TYPE_INT:
+            case spv::OP_TYPE_FLOAT: return type.operands[0] / 8;
+            case spv::OP_TYPE_VECTOR: return type_size(module, type.operands[0]) * type.operands[1];
+            case spv::OP_TYPE_MATRIX: {
+                uint32_t column = type_size(module, type.operands[0]);
+                return std::max(matrix_stride, column) * type.operands[1];
+            }
+            case spv::OP_TYPE_ARRAY: {
+                auto length = module.constants.find(type.operands[1]);
+                auto stride = module.array_strides.find(id);
+                uint32_t element = stride != module.array_strides.end() ? stride->second : type_size(module, type.operands[0], matrix_stride);
+                return length != module.constants.end() ? element * length->second : 0;
+            }
+            case spv::OP_TYPE_STRUCT: {
+                uint32_t size = 0;
+                for (uint32_t m = 0; m < type.operands.size(); m++) {
+                    auto offset = module.member_offsets.find(member_key(id, m));
+                    auto stride = module.matrix_strides.find(member_key(id, m));
+                    uint32_t member_size = type_size(module, type.operands[m], stride != module.matrix_strides.end() ? stride->second : 0);
+                    size = std::max(size, (offset != module.member_offsets.end() ? offset->second : size) + member_size);
+                }
+                return size;
+            }
+        }
+        return 0;
+    }
+
+    // Pointer type -> pointee.
+    uint32_t pointee(const Module& module, uint32_t pointer_type) {
+        auto it = module.types.find(pointer_type);
+        if (it == module.types.end() || it->second.op != spv::OP_TYPE_POINTER) return 0;
+        return it->second.operands[1];
+    }
+
+    const uint32_t* decoration(const Module& module, uint32_t id, uint32_t decoration) {
+        auto it = module.decorations.find(member_key(id, decoration));
+        return it == module.decorations.end() ? nullptr : &it->second;
+    }
+
+    const Type* find_type(const Module& module, uint32_t id) {
+        auto it = module.types.find(id);
+        return it == module.types.end() ? nullptr : &it->second;
+    }
+
+    // Descriptor type of a resource variable's (array element) type.
+    bool descriptor_type(const Module& module, uint32_t storage, uint32_t type_id, VkDescriptorType& out) {
+        const Type* type = find_type(module, type_id);
+        if (!type) return false;
+
+        if (storage == spv::STORAGE_STORAGE_BUFFER) {
+            out = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            return true;
+        }
+        if (storage == spv::STORAGE_UNIFORM) {
+            out = decoration(module, type_id, spv::DECORATION_BUFFER_BLOCK) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                         : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            return true;
+        }
+        if (storage != spv::STORAGE_UNIFORM_CONSTANT) return false;
+
+        switch (type->op) {
+            case spv::OP_TYPE_SAMPLER: out = VK_DESCRIPTOR_TYPE_SAMPLER; return true;
+            case spv::OP_TYPE_SAMPLED_IMAGE: out = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; return true;
+            case spv::OP_TYPE_IMAGE: {
+                // operands: sampled type, dim, depth, arrayed, ms, sampled, format
+                uint32_t dim = type->operands[1];
+                bool storage_image = type->operands[5] == 2;
+                if (dim == spv::DIM_SUBPASS_DATA) out = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                else if (dim == spv::DIM_BUFFER) out = storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                else out = storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool vertex_format(const Module& module, uint32_t type_id, VkFormat& format, uint32_t& size) {
+        const Type* type = find_type(module, type_id);
+        if (!type) return false;
+
+        uint32_t components = 1;
+        if (type->op == spv::OP_TYPE_VECTOR) {
+            components = type->operands[1];
+            type = find_type(module, type->operands[0]);
+            if (!type) return false;
+        }
+        if ((type->op != spv::OP_TYPE_FLOAT && type->op != spv::OP_TYPE_INT) || type->operands[0] != 32) return false;
+
+        static const VkFormat floats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        static const VkFormat sints[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        static const VkFormat uints[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+        if (components < 1 || components > 4) return false;
+
+        if (type->op == spv::OP_TYPE_FLOAT) format = floats[components - 1];
+        else format = type->operands[1] ? sints[components - 1] : uints[components - 1];
+        size = 4 * components;
+        return true;
+    }
+
+    VkShaderStageFlagBits stage_of(uint32_t execution_model) {
+        switch (execution_model) {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        throw std::runtime_error("unsupported SPIR-V execution model!");
+    }
+}
+
+ShaderReflection reflect_spirv(const std::vector<char>& code) {
+    Module module = parse(code);
+
+    ShaderReflection reflection;
+    reflection.stage = stage_of(module.execution_model);
+    // gl_Position is a gl_PerVertex member, or a plain variable when the
+    // shader redeclares it outside the block.
+    for (uint64_t member : module.position_members)
+        if (module.invariant_members.count(member)) reflection.invariant_position = true;
+    for (const auto& variable : module.variables) {
+        uint32_t type_id = pointee(module, variable.type);
+
+        if (variable.storage == spv::STORAGE_PUSH_CONSTANT) {
+            reflection.push_constant_size = std::max(reflection.push_constant_size, type_size(module, type_id));
+            continue;
+        }
+
+        const uint32_t* builtin = decoration(module, variable.id, spv::DECORATION_BUILT_IN);
+        if (builtin && *builtin == spv::BUILT_IN_POSITION && decoration(module, variable.id, spv::DECORATION_INVARIANT))
+            reflection.invariant_position = true;
+
+        if (variable.storage == spv::STORAGE_INPUT) {
+            const uint32_t* location = decoration(module, variable.id, spv::DECORATION_LOCATION);
+            if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || !location ||
+                decoration(module, variable.id, spv::DECORATION_BUILT_IN))
+                continue;
+            ReflectedVertexInput input{*location, VK_FORMAT_UNDEFINED, 0};
+            if (!vertex_format(module, type_id, input.format, input.size))
+                throw std::runtime_error("unsupported vertex input type in SPIR-V!");
+            reflection.vertex_inputs.push_back(input);
+            continue;
+        }
+
+        const uint32_t* binding = decoration(module, variable.id, spv::DECORATION_BINDING);
+        if (!binding) continue;
+        const uint32_t* set = decoration(module, variable.id, spv::DECORATION_DESCRIPTOR_SET);
+
+        // Arrays of resources: the element type decides the descriptor type.
+        uint32_t count = 1;
+        const Type* type = find_type(module, type_id);
+        if (type && type->op == spv::OP_TYPE_ARRAY) {
+            auto length = module.constants.find(type->operands[1]);
+            count = length != module.constants.end() ? length->second : 1;
+            type_id = type->operands[0];
+        } else if (type && type->op == spv::OP_TYPE_RUNTIME_ARRAY) {
+            count = 0;
+            type_id = type->operands[0];
+        }
+
+        ReflectedBinding reflected{set ? *set : 0, *binding, VK_DESCRIPTOR_TYPE_MAX_ENUM, count};
+        if (descriptor_type(module, variable.storage, type_id, reflected.type))
+            reflection.bindings.push_back(reflected);
+    }
+
+    std::sort(reflection.vertex_inputs.begin(), reflection.vertex_inputs.end(),
+              [](const auto& a, const auto& b) { return a.location < b.location; });
+    return reflection;
+}
+
+void check_push_constants(const ShaderReflection& shader, const std::vector<VkPushConstantRange>& ranges) {
+    if (shader.push_constant_size == 0) return;
+
+    // The block starts at offset 0; the ranges visible to this stage have to
+    // cover it without a gap.
+    uint32_t covered = 0;
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (const VkPushConstantRange& range : ranges) {
+            if ((range.stageFlags & shader.stage) && range.offset <= covered && range.offset + range.size > covered) {
+                covered = range.offset + range.size;
+                grew = true;
+            }
+        }
+    }
+    if (covered < shader.push_constant_size)
+        throw std::runtime_error("shader push constant block is larger than the pipeline layout's range!");
+}
+
+uint32_t reflect_vertex_attributes(const ShaderReflection& vertex,
+                                   std::vector<VkVertexInputAttributeDescription>& attributes) {
+    uint32_t offset = 0;
+    for (const ReflectedVertexInput& input : vertex.vertex_inputs) {
+        attributes.push_back({input.location, 0, input.format, offset});
+        offset += input.size;
+    }
+    return offset;
+}
+
+VkPipelineLayout build_pipeline_layout(const std::vector<ShaderReflection>& stages,
+                                       DescriptorLayoutCache& set_layouts, PipelineLayoutCache& pipeline_layouts,
+                                       const std::vector<std::pair<uint32_t, VkDescriptorSetLayout>>& fixed_sets,
+                                       const std::vector<VkPushConstantRange>& push_ranges) {
+    // set -> merged bindings; the same binding seen from several stages
+    // becomes one entry with the union of their stage flags.
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+    uint32_t push_size = 0;
+    VkShaderStageFlags push_stages = 0;
+
+    for (const ShaderReflection& stage : stages) {
+        if (stage.push_constant_size) {
+            push_size = std::max(push_size, stage.push_constant_size);
+            push_stages |= stage.stage;
+        }
+        for (const ReflectedBinding& reflected : stage.bindings) {
+            if (reflected.set >= sets.size()) sets.resize(reflected.set + 1);
+            auto& bindings = sets[reflected.set];
+            auto it = std::find_if(bindings.begin(), bindings.end(),
+                                   [&](const auto& b) { return b.binding == reflected.binding; });
+            if (it == bindings.end()) {
+                bindings.push_back({reflected.binding, reflected.type, reflected.count, static_cast<VkShaderStageFlags>(stage.stage), nullptr});
+                continue;
+            }
+            if (it->descriptorType != reflected.type || it->descriptorCount != reflected.count)
+                throw std::runtime_error("shader stages disagree on a descriptor binding!");
+            it->stageFlags |= stage.stage;
+        }
+    }
+    for (const auto& [set, layout] : fixed_sets)
+        if (set >= sets.size()) sets.resize(set + 1);
+
+    std::vector<VkDescriptorSetLayout> layouts(sets.size(), VK_NULL_HANDLE);
+    for (uint32_t set = 0; set < sets.size(); set++) {
+        auto fixed = std::find_if(fixed_sets.begin(), fixed_sets.end(), [&](const auto& f) { return f.first == set; });
+        if (fixed != fixed_sets.end()) {
+            layouts[set] = fixed->second;
+            continue;
+        }
+        for (const auto& binding : sets[set])
+            if (binding.descriptorCount == 0)
+                throw std::runtime_error("runtime descriptor arrays need a fixed (bindless) set layout!");
+        // Holes in the set numbering still need a (empty) layout.
+        layouts[set] = set_layouts.get(sets[set]);
+    }
+
+    std::vector<VkPushConstantRange> ranges = push_ranges;
+    if (ranges.empty() && push_size) ranges.push_back({push_stages, 0, push_size});
+    for (const ShaderReflection& stage : stages) check_push_constants(stage, ranges);
+    return pipeline_layouts.get(layouts, ranges);
+}
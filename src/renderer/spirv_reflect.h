@@ -0,0 +1,59 @@
+#pragma once
+
+#include "descriptors.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+struct ReflectedBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    // 0 for a runtime-sized array (bindless).
+    uint32_t count;
+};
+
+struct ReflectedVertexInput {
+    uint32_t location;
+    VkFormat format;
+    uint32_t size;
+};
+
+// What the engine needs to know about a shader module, read straight from
+// its SPIR-V words.
+struct ShaderReflection {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+    // Bytes of the push_constant block, 0 if the shader declares none.
+    uint32_t push_constant_size = 0;
+    std::vector<ReflectedBinding> bindings;
+    // Vertex stage only, sorted by location, built-ins excluded.
+    std::vector<ReflectedVertexInput> vertex_inputs;
+    // gl_Position is declared invariant, so every pipeline running the
+    // shader computes the same depth (the pre-pass relies on it).
+    bool invariant_position = false;
+};
+
+// Throws std::runtime_error on anything that is not a SPIR-V module.
+ShaderReflection reflect_spirv(const std::vector<char>& code);
+
+// Throws if a shader's push constant block does not fit the ranges declared
+// for its stage, which Vulkan would otherwise only catch in validation.
+void check_push_constants(const ShaderReflection& shader, const std::vector<VkPushConstantRange>& ranges);
+
+// Attribute descriptions for the vertex inputs, tightly packed in binding
+// 0 in location order; returns the stride.
+uint32_t reflect_vertex_attributes(const ShaderReflection& vertex,
+                                   std::vector<VkVertexInputAttributeDescription>& attributes);
+
+// Merges the stages' bindings and push constants into one layout. Set
+// layouts come from `set_layouts` and the pipeline layout from
+// `pipeline_layouts`, so shaders with the same interface share handles.
+// A set listed in `fixed_sets` (e.g. the bindless set) is used as given
+// instead of being built from reflection. Non-empty `push_ranges` replace
+// the reflected range, so layouts sharing a push contract declare the same
+// stages; every stage is checked against them.
+VkPipelineLayout build_pipeline_layout(const std::vector<ShaderReflection>& stages,
+                                       DescriptorLayoutCache& set_layouts, PipelineLayoutCache& pipeline_layouts,
+                                       const std::vector<std::pair<uint32_t, VkDescriptorSetLayout>>& fixed_sets = {},
+                                       const std::vector<VkPushConstantRange>& push_ranges = {});
@@ -0,0 +1,222 @@
+#include "texture.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+uint32_t mip_count(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) levels++;
+    return levels;
+}
+
+bool supports_mip_blit(VkPhysicalDevice physical_device, VkFormat format) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
+    VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                  VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & needed) == needed;
+}
+
+VkDeviceSize pack_staging_levels(const std::vector<VkDeviceSize>& level_sizes, std::vector<VkDeviceSize>& offsets) {
+    VkDeviceSize size = 0;
+    for (VkDeviceSize levelSize : level_sizes) {
+        offsets.push_back(size);
+        size = (size + levelSize + 15) & ~VkDeviceSize(15);
+    }
+    return size;
+}
+
+VkSamplerCreateInfo default_sampler_info() {
+    VkSamplerCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    info.magFilter = VK_FILTER_LINEAR;
+    info.minFilter = VK_FILTER_LINEAR;
+    info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    info.maxLod = VK_LOD_CLAMP_NONE;
+    return info;
+}
+
+VkFormat codec_format(BlockCodec codec, bool srgb) {
+    switch (codec) {
+        case BlockCodec::RGBA8: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        case BlockCodec::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case BlockCodec::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case BlockCodec::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case BlockCodec::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+namespace {
+    VkImageMemoryBarrier image_barrier(VkImage image, uint32_t base_mip, uint32_t mip_count,
+                                       VkImageLayout old_layout, VkImageLayout new_layout,
+                                       VkAccessFlags src_access, VkAccessFlags dst_access) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, base_mip, mip_count, 0, 1};
+        return barrier;
+    }
+
+    void flush(VkCommandBuffer command_buffer, std::vector<VkImageMemoryBarrier>& barriers,
+               VkPipelineStageFlags src, VkPipelineStageFlags dst) {
+        if (barriers.empty()) return;
+        vkCmdPipelineBarrier(command_buffer, src, dst, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+        barriers.clear();
+    }
+
+    int32_t mip_size(uint32_t size, uint32_t level) {
+        return static_cast<int32_t>(std::max(size >> level, 1u));
+    }
+}
+
+void record_texture_uploads(VkCommandBuffer command_buffer, const std::vector<TextureUpload>& uploads) {
+    if (uploads.empty()) return;
+    std::vector<VkImageMemoryBarrier> barriers;
+    uint32_t maxLevels = 1;
+
+    for (const TextureUpload& upload : uploads) {
+        barriers.push_back(image_barrier(upload.image, 0, upload.mip_levels, VK_IMAGE_LAYOUT_UNDEFINED,
+                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+        maxLevels = std::max(maxLevels, upload.mip_levels);
+    }
+    flush(command_buffer, barriers, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    for (const TextureUpload& upload : uploads) {
+        std::vector<VkBufferImageCopy> regions(upload.level_offsets.size());
+        for (uint32_t level = 0; level < regions.size(); level++) {
+            regions[level].bufferOffset = upload.level_offsets[level];
+            regions[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            regions[level].imageExtent = {static_cast<uint32_t>(mip_size(upload.extent.width, level)),
+                                          static_cast<uint32_t>(mip_size(upload.extent.height, level)), 1};
+        }
+        vkCmdCopyBufferToImage(command_buffer, upload.staging, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    // Level by level across every texture, so the barrier count grows with
+    // the deepest chain rather than with the number of textures.
+    auto generated = [](const TextureUpload& upload, uint32_t level) {
+        return level >= upload.level_offsets.size() && level < upload.mip_levels;
+    };
+    for (uint32_t level = 1; level < maxLevels; level++) {
+        for (const TextureUpload& upload : uploads) {
+            if (!generated(upload, level)) continue;
+            barriers.push_back(image_barrier(upload.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                             VK_ACCESS_TRANSFER_READ_BIT));
+        }
+        flush(command_buffer, barriers, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        for (const TextureUpload& upload : uploads) {
+            if (!generated(upload, level)) continue;
+            VkImageBlit blit{};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+            blit.srcOffsets[1] = {mip_size(upload.extent.width, level - 1), mip_size(upload.extent.height, level - 1), 1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            blit.dstOffsets[1] = {mip_size(upload.extent.width, level), mip_size(upload.extent.height, level), 1};
+            vkCmdBlitImage(command_buffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        }
+    }
+
+    // Copied levels are still TRANSFER_DST, except the last one when it was
+    // the source of the first blit; every blitted level but the last was a
+    // source too.
+    const VkPipelineStageFlags shaders = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    for (const TextureUpload& upload : uploads) {
+        uint32_t copied = static_cast<uint32_t>(upload.level_offsets.size());
+        uint32_t last = upload.mip_levels - 1;
+        uint32_t firstSource = upload.mip_levels > copied ? copied - 1 : upload.mip_levels;
+        if (firstSource > 0)
+            barriers.push_back(image_barrier(upload.image, 0, firstSource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                             VK_ACCESS_SHADER_READ_BIT));
+        if (firstSource < last) {
+            barriers.push_back(image_barrier(upload.image, firstSource, last - firstSource,
+                                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                             VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT));
+            barriers.push_back(image_barrier(upload.image, last, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                             VK_ACCESS_SHADER_READ_BIT));
+        }
+    }
+    flush(command_buffer, barriers, VK_PIPELINE_STAGE_TRANSFER_BIT, shaders);
+}
+
+// ---------------- sampler cache ----------------
+void SamplerCache::init(VkDevice device) {
+    m_device = device;
+}
+
+void SamplerCache::deinit() {
+    for (auto& [key, sampler] : m_samplers) vkDestroySampler(m_device, sampler, host_allocator());
+    m_samplers.clear();
+}
+
+bool SamplerCache::Key::operator==(const Key& other) const {
+    const VkSamplerCreateInfo& a = info;
+    const VkSamplerCreateInfo& b = other.info;
+    return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter &&
+           a.mipmapMode == b.mipmapMode && a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV &&
+           a.addressModeW == b.addressModeW && a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable &&
+           a.maxAnisotropy == b.maxAnisotropy && a.compareEnable == b.compareEnable && a.compareOp == b.compareOp &&
+           a.minLod == b.minLod && a.maxLod == b.maxLod && a.borderColor == b.borderColor &&
+           a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const {
+    // FNV-1a over the fields operator== compares.
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    auto mixFloat = [&](float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        mix(bits);
+    };
+    const VkSamplerCreateInfo& info = key.info;
+    mix(info.flags);
+    mix(static_cast<uint64_t>(info.magFilter) | static_cast<uint64_t>(info.minFilter) << 8 |
+        static_cast<uint64_t>(info.mipmapMode) << 16);
+    mix(static_cast<uint64_t>(info.addressModeU) | static_cast<uint64_t>(info.addressModeV) << 8 |
+        static_cast<uint64_t>(info.addressModeW) << 16);
+    mixFloat(info.mipLodBias);
+    mix(info.anisotropyEnable);
+    mixFloat(info.maxAnisotropy);
+    mix(info.compareEnable);
+    mix(static_cast<uint64_t>(info.compareOp));
+    mixFloat(info.minLod);
+    mixFloat(info.maxLod);
+    mix(static_cast<uint64_t>(info.borderColor));
+    mix(info.unnormalizedCoordinates);
+    return static_cast<size_t>(hash);
+}
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo& info) {
+    if (info.pNext) throw std::runtime_error("sampler cache does not support chained create infos!");
+
+    Key key{info};
+    auto it = m_samplers.find(key);
+    if (it != m_samplers.end()) return it->second;
+
+    VkSampler sampler;
+    if (vkCreateSampler(m_device, &info, host_allocator(), &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create sampler!");
+    m_samplers.emplace(key, sampler);
+    return sampler;
+}
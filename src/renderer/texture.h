@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../utils/bc.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Levels in a full mip chain down to 1x1.
+uint32_t mip_count(uint32_t width, uint32_t height);
+
+// Whether `format` can be blitted with linear filtering, which GPU mip
+// generation needs.
+bool supports_mip_blit(VkPhysicalDevice physical_device, VkFormat format);
+
+// Lays levels of `level_sizes` bytes out back to back in a staging buffer:
+// appends each level's offset to `offsets` and returns the total size.
+// Copy offsets must be multiples of the texel block size; 16 covers every
+// format textures use.
+VkDeviceSize pack_staging_levels(const std::vector<VkDeviceSize>& level_sizes, std::vector<VkDeviceSize>& offsets);
+
+// Trilinear, repeating, all levels: what textures are sampled with unless a
+// material asks for something else.
+VkSamplerCreateInfo default_sampler_info();
+
+// Sampled format for baked texture data. BC5 (normals) is always UNORM.
+VkFormat codec_format(BlockCodec codec, bool srgb);
+
+// A texture waiting for its first upload: the image is still UNDEFINED and
+// the first `level_offsets.size()` levels sit in `staging` at those offsets
+// (precomputed mips, or just level 0). Levels below them are blitted.
+struct TextureUpload {
+    VkImage image;
+    VkBuffer staging;
+    std::vector<VkDeviceSize> level_offsets;
+    VkExtent2D extent;
+    uint32_t mip_levels;
+};
+
+// Records the uploads of many textures into one command buffer. Every
+// step is batched across all of them: one barrier into TRANSFER_DST, the
+// copies, then per generated mip level one barrier and the blits from the
+// level above, and finally one barrier to SHADER_READ_ONLY_OPTIMAL for
+// fragment and compute shaders. Blits need a graphics queue; textures
+// whose levels are all precomputed (compressed ones) only copy.
+void record_texture_uploads(VkCommandBuffer command_buffer, const std::vector<TextureUpload>& uploads);
+
+// Deduplicates samplers by their create info, so materials asking for the
+// same filtering share one VkSampler and stay under maxSamplerAllocationCount.
+// Chained create infos (pNext) are not supported. Samplers live until deinit().
+struct SamplerCache {
+    void init(VkDevice device);
+    void deinit();
+
+    VkSampler get(const VkSamplerCreateInfo& info);
+
+    uint32_t size() const { return static_cast<uint32_t>(m_samplers.size()); }
+
+    private:
+    struct Key {
+        VkSamplerCreateInfo info;
+
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<Key, VkSampler, KeyHash> m_samplers;
+};
@@ -0,0 +1,461 @@
+#include "texture_streaming.h"
+#include "host_allocator.h"
+#include "texture.h"
+#include "../profiler/profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    const uint32_t NOT_SAMPLED = 0xFFFFFFFFu;
+
+    uint32_t level_size(uint32_t size, uint32_t level) {
+        return std::max(size >> level, 1u);
+    }
+
+    VkImageMemoryBarrier image_barrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                       VkAccessFlags src_access, VkAccessFlags dst_access) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+        return barrier;
+    }
+}
+
+void TextureStreamer::init(VkPhysicalDevice physical_device, VkDevice device, uint32_t frame_count,
+                           GpuAllocator& allocator, BindlessHeap& bindless, VkSampler sampler, JobSystem* jobs,
+                           DescriptorLayoutCache& layout_cache, MemoryBudget* budget) {
+    m_physical_device = physical_device;
+    m_device = device;
+    m_allocator = &allocator;
+    m_bindless = &bindless;
+    m_sampler = sampler;
+    m_jobs = jobs;
+
+    m_layout = layout_cache.get({
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+    });
+
+    const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    m_frames.resize(frame_count);
+    for (Frame& frame : m_frames) {
+        frame.table.track(budget, MemoryCategory::OTHER);
+        frame.feedback.track(budget, MemoryCategory::OTHER);
+        bool ok = frame.table.init(physical_device, device, sizeof(TableEntry) * MAX_TEXTURES,
+                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible) &&
+                  frame.feedback.init(physical_device, device, sizeof(uint32_t) * MAX_TEXTURES,
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+        if (!ok) throw std::runtime_error("failed to create texture streaming buffers!");
+
+        vkMapMemory(device, frame.table.m_memory, 0, VK_WHOLE_SIZE, 0, &frame.mapped_table);
+        vkMapMemory(device, frame.feedback.m_memory, 0, VK_WHOLE_SIZE, 0, &frame.mapped_feedback);
+
+    }
+}
+
+// The set layout belongs to the cache; bindless slots go with the heap.
+void TextureStreamer::deinit(VkDevice device) {
+    if (m_jobs) m_jobs->wait(m_counter);
+    m_loads.clear();
+    m_rebuilds.clear();
+
+    collect(UINT64_MAX);
+    for (Texture& texture : m_textures) {
+        if (texture.view) vkDestroyImageView(device, texture.view, host_allocator());
+        if (texture.image) vkDestroyImage(device, texture.image, host_allocator());
+        m_allocator->free(texture.allocation);
+    }
+    m_textures.clear();
+
+    for (Frame& frame : m_frames) {
+        frame.table.deinit(device);
+        frame.feedback.deinit(device);
+    }
+    m_frames.clear();
+    m_layout = VK_NULL_HANDLE;
+    m_resident_bytes = 0;
+}
+
+VkDeviceSize TextureStreamer::level_bytes(const Texture& texture, uint32_t level) const {
+    if (texture.decode)
+        return VkDeviceSize(level_size(texture.info.width, level)) * level_size(texture.info.height, level) * 4;
+    return texture.info.level_sizes[level];
+}
+
+VkDeviceSize TextureStreamer::resident_bytes(const Texture& texture, uint32_t first) const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = first; level < texture.info.level_count(); level++) bytes += level_bytes(texture, level);
+    return bytes;
+}
+
+uint32_t TextureStreamer::add(const std::string& path) {
+    if (m_textures.size() >= MAX_TEXTURES) throw std::runtime_error("too many streamed textures!");
+
+    Texture texture;
+    texture.path = path;
+    texture.info = read_texture_asset_info(path);
+    texture.format = codec_format(texture.info.codec, texture.info.srgb);
+
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(m_physical_device, texture.format, &props);
+    if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        texture.decode = true;
+        texture.format = codec_format(BlockCodec::RGBA8, texture.info.srgb);
+    }
+
+    uint32_t levels = texture.info.level_count();
+    texture.tail = levels - 1;
+    for (uint32_t level = 0; level < levels; level++) {
+        if (std::max(level_size(texture.info.width, level), level_size(texture.info.height, level)) <= TAIL_SIZE) {
+            texture.tail = level;
+            break;
+        }
+    }
+    texture.first = texture.wanted = texture.tail;
+    texture.rebuilding = true;
+
+    Rebuild rebuild{static_cast<uint32_t>(m_textures.size()), texture.tail, {}};
+    for (uint32_t level = texture.tail; level < levels; level++) {
+        std::vector<uint8_t> data = read_texture_asset_level(path, texture.info, level);
+        if (texture.decode)
+            data = decode_image(texture.info.codec, data.data(), level_size(texture.info.width, level),
+                                level_size(texture.info.height, level));
+        rebuild.levels.push_back(std::move(data));
+    }
+
+    m_resident_bytes += resident_bytes(texture, texture.tail);
+    m_rebuilds.push_back(std::move(rebuild));
+    m_textures.push_back(std::move(texture));
+    return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+void TextureStreamer::start_load(uint32_t index) {
+    Texture& texture = m_textures[index];
+    texture.loading = true;
+
+    auto load = std::make_unique<Load>();
+    load->texture = index;
+    load->level = texture.first - 1;
+    m_resident_bytes += level_bytes(texture, load->level);
+
+    Load* target = load.get();
+    std::string path = texture.path;
+    TextureAssetInfo info = texture.info;
+    bool decode = texture.decode;
+    auto job = [target, path, info, decode]() {
+        PROFILE_ZONE("texture stream load");
+        try {
+            target->data = read_texture_asset_level(path, info, target->level);
+            if (decode)
+                target->data = decode_image(info.codec, target->data.data(), level_size(info.width, target->level),
+                                            level_size(info.height, target->level));
+        } catch (const std::exception& e) {
+            std::cout << "texture streaming: " << path << ": " << e.what() << "\n";
+            target->failed = true;
+        }
+        target->done.store(true, std::memory_order_release);
+    };
+
+    m_loads.push_back(std::move(load));
+    if (m_jobs) m_jobs->run("texture stream load", job, &m_counter);
+    else job();
+}
+
+// Drops the finest level of the least recently seen texture that either
+// was not in the last feedback or has more detail than it asked for.
+bool TextureStreamer::evict_one(uint32_t keep) {
+    uint32_t victim = UINT32_MAX;
+    for (uint32_t i = 0; i < m_textures.size(); i++) {
+        const Texture& texture = m_textures[i];
+        if (i == keep || texture.loading || texture.rebuilding || texture.first >= texture.tail) continue;
+        if (texture.last_used == m_frame_number && texture.first >= texture.wanted) continue;
+        if (victim == UINT32_MAX || texture.last_used < m_textures[victim].last_used) victim = i;
+    }
+    if (victim == UINT32_MAX) return false;
+
+    Texture& texture = m_textures[victim];
+    m_resident_bytes -= level_bytes(texture, texture.first);
+    texture.first++;
+    texture.rebuilding = true;
+    m_rebuilds.push_back({victim, texture.first, {}});
+    m_levels_evicted++;
+    return true;
+}
+
+void TextureStreamer::begin_frame(uint32_t frame_index) {
+    PROFILE_ZONE("texture streaming");
+    Frame& frame = m_frames[frame_index];
+    m_frame_number++;
+
+    const uint32_t* feedback = static_cast<const uint32_t*>(frame.mapped_feedback);
+    for (uint32_t i = 0; i < frame.texture_count; i++) {
+        if (feedback[i] == NOT_SAMPLED) continue;
+        Texture& texture = m_textures[i];
+        texture.last_used = m_frame_number;
+        texture.wanted = std::min(feedback[i], texture.tail);
+    }
+
+    for (size_t i = 0; i < m_loads.size();) {
+        Load& load = *m_loads[i];
+        if (!load.done.load(std::memory_order_acquire) || m_textures[load.texture].rebuilding) {
+            i++;
+            continue;
+        }
+        Texture& texture = m_textures[load.texture];
+        texture.loading = false;
+        if (load.failed) {
+            m_resident_bytes -= level_bytes(texture, load.level);
+        } else {
+            texture.first = load.level;
+            texture.rebuilding = true;
+            m_rebuilds.push_back({load.texture, load.level, {}});
+            m_rebuilds.back().levels.push_back(std::move(load.data));
+            m_levels_streamed++;
+        }
+        m_loads.erase(m_loads.begin() + i);
+    }
+
+    // Biggest gap between wanted and resident first, then most recently seen.
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < m_textures.size(); i++) {
+        const Texture& texture = m_textures[i];
+        if (!texture.loading && !texture.rebuilding && texture.wanted < texture.first) candidates.push_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+        const Texture& ta = m_textures[a];
+        const Texture& tb = m_textures[b];
+        if (ta.first - ta.wanted != tb.first - tb.wanted) return ta.first - ta.wanted > tb.first - tb.wanted;
+        return ta.last_used > tb.last_used;
+    });
+
+    for (uint32_t index : candidates) {
+        if (m_loads.size() >= MAX_LOADS_IN_FLIGHT) break;
+        VkDeviceSize needed = level_bytes(m_textures[index], m_textures[index].first - 1);
+        while (m_resident_bytes + needed > budget && evict_one(index)) {}
+        if (m_resident_bytes + needed > budget) break;
+        start_load(index);
+    }
+    while (m_resident_bytes > budget && evict_one(UINT32_MAX)) {}
+}
+
+void TextureStreamer::record(VkCommandBuffer command_buffer, uint32_t frame_index, uint64_t value, VkDescriptorSet set) {
+    Frame& frame = m_frames[frame_index];
+    frame.set = set;
+    VkDescriptorBufferInfo bufferInfos[2] = {
+        {frame.table.get_buffer(), 0, VK_WHOLE_SIZE},
+        {frame.feedback.get_buffer(), 0, VK_WHOLE_SIZE},
+    };
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+
+    if (!m_rebuilds.empty()) {
+        // One staging buffer for every new level of the frame.
+        std::vector<VkDeviceSize> levelSizes;
+        for (const Rebuild& rebuild : m_rebuilds)
+            for (const auto& level : rebuild.levels) levelSizes.push_back(level.size());
+        std::vector<VkDeviceSize> levelOffsets;
+        VkDeviceSize stagingSize = pack_staging_levels(levelSizes, levelOffsets);
+
+        VkBuffer staging = VK_NULL_HANDLE;
+        GpuAllocation stagingMemory;
+        if (stagingSize > 0) {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = stagingSize;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateBuffer(m_device, &bufferInfo, host_allocator(), &staging) != VK_SUCCESS)
+                throw std::runtime_error("failed to create texture streaming staging buffer!");
+            stagingMemory = m_allocator->allocate_buffer(
+                staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::STAGING);
+        }
+
+        struct Target {
+            VkImage image;
+            VkImageView view;
+            GpuAllocation allocation;
+        };
+        std::vector<Target> targets;
+        std::vector<VkImageMemoryBarrier> barriers;
+        for (const Rebuild& rebuild : m_rebuilds) {
+            const Texture& texture = m_textures[rebuild.texture];
+            Target target{};
+
+            VkImageCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            info.imageType = VK_IMAGE_TYPE_2D;
+            info.format = texture.format;
+            info.extent = {level_size(texture.info.width, rebuild.first), level_size(texture.info.height, rebuild.first), 1};
+            info.mipLevels = texture.info.level_count() - rebuild.first;
+            info.arrayLayers = 1;
+            info.samples = VK_SAMPLE_COUNT_1_BIT;
+            info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(m_device, &info, host_allocator(), &target.image) != VK_SUCCESS)
+                throw std::runtime_error("failed to create streamed texture image!");
+            target.allocation = m_allocator->allocate_image(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                            MemoryCategory::TEXTURES);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = target.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = texture.format;
+            viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, info.mipLevels, 0, 1};
+            if (vkCreateImageView(m_device, &viewInfo, host_allocator(), &target.view) != VK_SUCCESS)
+                throw std::runtime_error("failed to create streamed texture image view!");
+
+            barriers.push_back(image_barrier(target.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             0, VK_ACCESS_TRANSFER_WRITE_BIT));
+            if (texture.image)
+                barriers.push_back(image_barrier(texture.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                                                 VK_ACCESS_TRANSFER_READ_BIT));
+            targets.push_back(target);
+        }
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        barriers.clear();
+
+        size_t staged = 0;
+        for (size_t i = 0; i < m_rebuilds.size(); i++) {
+            const Rebuild& rebuild = m_rebuilds[i];
+            const Texture& texture = m_textures[rebuild.texture];
+            const Target& target = targets[i];
+
+            std::vector<VkBufferImageCopy> regions;
+            for (uint32_t j = 0; j < rebuild.levels.size(); j++) {
+                uint32_t level = rebuild.first + j;
+                VkDeviceSize offset = levelOffsets[staged++];
+                std::memcpy(static_cast<char*>(stagingMemory.mapped) + offset, rebuild.levels[j].data(),
+                            rebuild.levels[j].size());
+                VkBufferImageCopy region{};
+                region.bufferOffset = offset;
+                region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, j, 0, 1};
+                region.imageExtent = {level_size(texture.info.width, level), level_size(texture.info.height, level), 1};
+                regions.push_back(region);
+            }
+            if (!regions.empty())
+                vkCmdCopyBufferToImage(command_buffer, staging, target.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       static_cast<uint32_t>(regions.size()), regions.data());
+
+            std::vector<VkImageCopy> copies;
+            uint32_t firstCopied = std::max(rebuild.first + static_cast<uint32_t>(rebuild.levels.size()), texture.image_first);
+            for (uint32_t level = firstCopied; texture.image && level < texture.info.level_count(); level++) {
+                VkImageCopy copy{};
+                copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.image_first, 0, 1};
+                copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - rebuild.first, 0, 1};
+                copy.extent = {level_size(texture.info.width, level), level_size(texture.info.height, level), 1};
+                copies.push_back(copy);
+            }
+            if (!copies.empty())
+                vkCmdCopyImage(command_buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
+
+            barriers.push_back(image_barrier(target.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                             VK_ACCESS_SHADER_READ_BIT));
+        }
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        // The old images were last read by this frame's copies.
+        for (size_t i = 0; i < m_rebuilds.size(); i++) {
+            Texture& texture = m_textures[m_rebuilds[i].texture];
+            if (texture.image) {
+                m_retired.push_back({value, texture.image, texture.view, VK_NULL_HANDLE});
+                m_allocator->free(texture.allocation, value);
+                m_bindless->remove_texture(texture.slot, value);
+            }
+            texture.image = targets[i].image;
+            texture.view = targets[i].view;
+            texture.allocation = targets[i].allocation;
+            texture.image_first = m_rebuilds[i].first;
+            texture.slot = m_bindless->add_texture(m_device, texture.view, m_sampler);
+            texture.rebuilding = false;
+        }
+        if (staging) {
+            m_retired.push_back({value, VK_NULL_HANDLE, VK_NULL_HANDLE, staging});
+            m_allocator->free(stagingMemory, value);
+        }
+        m_rebuilds.clear();
+    }
+
+    TableEntry* table = static_cast<TableEntry*>(frame.mapped_table);
+    for (uint32_t i = 0; i < m_textures.size(); i++) {
+        const Texture& texture = m_textures[i];
+        table[i] = {texture.slot, texture.info.width, texture.info.height, texture.image_first};
+    }
+    frame.texture_count = static_cast<uint32_t>(m_textures.size());
+
+    vkCmdFillBuffer(command_buffer, frame.feedback.get_buffer(), 0, VK_WHOLE_SIZE, NOT_SAMPLED);
+    VkBufferMemoryBarrier clear{};
+    clear.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    clear.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clear.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    clear.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clear.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clear.buffer = frame.feedback.get_buffer();
+    clear.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 1, &clear, 0, nullptr);
+}
+
+void TextureStreamer::finish(VkCommandBuffer command_buffer, uint32_t frame_index) {
+    VkBufferMemoryBarrier host{};
+    host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    host.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.buffer = m_frames[frame_index].feedback.get_buffer();
+    host.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &host, 0, nullptr);
+}
+
+void TextureStreamer::bind(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t frame_index) const {
+    if (!enabled()) return;
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, SET, 1,
+                            &m_frames[frame_index].set, 0, nullptr);
+}
+
+void TextureStreamer::collect(uint64_t completed) {
+    while (!m_retired.empty() && m_retired.front().value <= completed) {
+        Retired& retired = m_retired.front();
+        if (retired.view) vkDestroyImageView(m_device, retired.view, host_allocator());
+        if (retired.image) vkDestroyImage(m_device, retired.image, host_allocator());
+        if (retired.staging) vkDestroyBuffer(m_device, retired.staging, host_allocator());
+        m_retired.pop_front();
+    }
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const {
+    Stats stats;
+    stats.textures = static_cast<uint32_t>(m_textures.size());
+    stats.loads_in_flight = static_cast<uint32_t>(m_loads.size());
+    stats.resident_bytes = m_resident_bytes;
+    stats.levels_streamed = m_levels_streamed;
+    stats.levels_evicted = m_levels_evicted;
+    return stats;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "allocator.h"
+#include "bindless.h"
+#include "buffer.h"
+#include "descriptors.h"
+#include "../jobs/job_system.h"
+#include "../utils/texture_asset.h"
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Mip streaming for baked (.rtex) textures that do not all fit in memory.
+// Only the coarse tail of each chain (levels up to TAIL_SIZE pixels) is
+// loaded by add(); finer levels are streamed in when shaders ask for them.
+//
+// Shaders sample through sample_streamed() in assets/shaders/streaming.glsl,
+// which also writes the finest level the pixel wanted into a per-frame
+// feedback buffer. No built-in shader does; the application's own fragment
+// shaders include it. Once the frame has completed, begin_frame() reads it
+// back, loads the next finer level of every texture that wants more on a
+// worker, and, while over `budget`, drops the finest level of the least
+// recently seen textures first. A texture's image is rebuilt with the new
+// level range in record(): resident levels are copied on the GPU, the new
+// one comes from staging, and the bindless slot is swapped. Shaders find
+// the current slot through a per-frame table, so frames in flight keep
+// sampling the old image until they retire it.
+//
+// Needs the bindless heap. Call everything from the render thread.
+struct TextureStreamer {
+    static const uint32_t MAX_TEXTURES = 4096;
+    // Levels no larger than this on their longest side stay resident.
+    static const uint32_t TAIL_SIZE = 128;
+    static const uint32_t MAX_LOADS_IN_FLIGHT = 8;
+    // Set index the streaming set is bound at in graphics pipeline layouts.
+    static const uint32_t SET = 2;
+
+    // The per-frame table and feedback buffers are tracked in `budget` as
+    // OTHER when given.
+    void init(VkPhysicalDevice physical_device, VkDevice device, uint32_t frame_count, GpuAllocator& allocator,
+              BindlessHeap& bindless, VkSampler sampler, JobSystem* jobs, DescriptorLayoutCache& layout_cache,
+              MemoryBudget* budget = nullptr);
+    // Waits for outstanding loads; the device must be idle.
+    void deinit(VkDevice device);
+
+    // Reads the header and the tail levels right away; returns the id
+    // shaders pass to sample_streamed().
+    uint32_t add(const std::string& path);
+
+    // After the frame slot's wait: reads the feedback that frame wrote,
+    // picks up finished loads, evicts and starts new loads.
+    void begin_frame(uint32_t frame);
+    // Outside a render pass, before any draw that samples: rebuilds the
+    // images that changed, publishes the slot table and clears the frame's
+    // feedback. `value` is the timeline value this frame's submit signals;
+    // `set` is a fresh set of layout() that lives for the frame, written
+    // here and bound by bind().
+    void record(VkCommandBuffer command_buffer, uint32_t frame, uint64_t value, VkDescriptorSet set);
+    // After the last draw: makes the feedback writes visible to the host.
+    void finish(VkCommandBuffer command_buffer, uint32_t frame);
+    void bind(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t frame) const;
+    // Destroys rebuilt-away images once `completed` has passed them.
+    void collect(uint64_t completed);
+
+    bool enabled() const { return m_layout != VK_NULL_HANDLE && !m_frames.empty(); }
+    VkDescriptorSetLayout layout() const { return m_layout; }
+
+    // Bytes of texture levels kept resident; the tails always are.
+    VkDeviceSize budget = 256ull << 20;
+
+    struct Stats {
+        uint32_t textures = 0;
+        uint32_t loads_in_flight = 0;
+        VkDeviceSize resident_bytes = 0;
+        uint64_t levels_streamed = 0;
+        uint64_t levels_evicted = 0;
+    };
+    Stats stats() const;
+
+    private:
+    // std430; matches `StreamedTexture` in streaming.glsl.
+    struct TableEntry {
+        uint32_t slot;
+        uint32_t width;
+        uint32_t height;
+        uint32_t first_level;
+    };
+
+    struct Texture {
+        std::string path;
+        TextureAssetInfo info;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        // Levels are decoded to RGBA8 on the worker when the device cannot
+        // sample `info.codec`.
+        bool decode = false;
+        uint32_t tail = 0;
+        // Finest resident level, and the finest the last feedback asked for.
+        uint32_t first = 0;
+        uint32_t wanted = 0;
+        uint64_t last_used = 0;
+        bool loading = false;
+        bool rebuilding = false;
+        // Level range of `image`, which lags `first` until the rebuild.
+        uint32_t image_first = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        uint32_t slot = 0;
+    };
+
+    struct Load {
+        uint32_t texture;
+        uint32_t level;
+        std::vector<uint8_t> data;
+        bool failed = false;
+        std::atomic<bool> done{false};
+    };
+
+    // New level range for a texture; `levels` holds the data for levels
+    // first .. first + levels.size() - 1, the rest is copied from the old image.
+    struct Rebuild {
+        uint32_t texture;
+        uint32_t first;
+        std::vector<std::vector<uint8_t>> levels;
+    };
+
+    struct Frame {
+        VulkanBuffer table;
+        VulkanBuffer feedback;
+        void* mapped_table = nullptr;
+        void* mapped_feedback = nullptr;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        // Textures the frame's feedback covers.
+        uint32_t texture_count = 0;
+    };
+
+    struct Retired {
+        uint64_t value;
+        VkImage image;
+        VkImageView view;
+        VkBuffer staging;
+    };
+
+    VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+    VkDevice m_device = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    BindlessHeap* m_bindless = nullptr;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    JobSystem* m_jobs = nullptr;
+    JobCounter m_counter;
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames;
+    std::vector<Texture> m_textures;
+    std::vector<std::unique_ptr<Load>> m_loads;
+    std::vector<Rebuild> m_rebuilds;
+    std::deque<Retired> m_retired;
+    uint64_t m_frame_number = 0;
+    VkDeviceSize m_resident_bytes = 0;
+    uint64_t m_levels_streamed = 0;
+    uint64_t m_levels_evicted = 0;
+
+    VkDeviceSize level_bytes(const Texture& texture, uint32_t level) const;
+    VkDeviceSize resident_bytes(const Texture& texture, uint32_t first) const;
+    bool evict_one(uint32_t keep);
+    void start_load(uint32_t texture);
+};
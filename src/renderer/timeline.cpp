@@ -0,0 +1,174 @@
+#include "timeline.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// ---------------- submit description ----------------
+void TimelineSubmit::wait(QueueTimeline& timeline, uint64_t value, VkPipelineStageFlags stage) {
+    if (m_wait_count == MAX_SEMAPHORES) throw std::runtime_error("too many timeline waits in one submit!");
+    m_waits[m_wait_count++] = {&timeline, value, stage};
+}
+
+void TimelineSubmit::wait_binary(VkSemaphore semaphore, VkPipelineStageFlags stage) {
+    if (m_binary_wait_count == MAX_SEMAPHORES) throw std::runtime_error("too many semaphore waits in one submit!");
+    m_binary_stages[m_binary_wait_count] = stage;
+    m_binary_waits[m_binary_wait_count++] = semaphore;
+}
+
+void TimelineSubmit::signal_binary(VkSemaphore semaphore) {
+    if (m_binary_signal_count == MAX_SEMAPHORES) throw std::runtime_error("too many semaphore signals in one submit!");
+    m_binary_signals[m_binary_signal_count++] = semaphore;
+}
+
+// ---------------- timeline ----------------
+void QueueTimeline::init(VkDevice device, VkQueue queue, bool use_semaphore) {
+    m_queue = queue;
+    m_use_semaphore = use_semaphore;
+    m_submitted = 0;
+    m_completed = 0;
+    if (!use_semaphore) return;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    info.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &info, host_allocator(), &m_semaphore) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timeline semaphore!");
+}
+
+void QueueTimeline::deinit(VkDevice device) {
+    if (m_semaphore) vkDestroySemaphore(device, m_semaphore, host_allocator());
+    m_semaphore = VK_NULL_HANDLE;
+
+    for (auto& [value, fence] : m_pending) vkDestroyFence(device, fence, host_allocator());
+    for (VkFence fence : m_free_fences) vkDestroyFence(device, fence, host_allocator());
+    m_pending.clear();
+    m_free_fences.clear();
+}
+
+VkFence QueueTimeline::acquire_fence(VkDevice device) {
+    if (!m_free_fences.empty()) {
+        VkFence fence = m_free_fences.back();
+        m_free_fences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device, &info, host_allocator(), &fence) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timeline fence!");
+    return fence;
+}
+
+uint64_t QueueTimeline::submit(VkDevice device, const TimelineSubmit& submit) {
+    uint64_t value = m_submitted + 1;
+
+    VkSemaphore waits[TimelineSubmit::MAX_SEMAPHORES * 2];
+    VkPipelineStageFlags stages[TimelineSubmit::MAX_SEMAPHORES * 2];
+    uint64_t wait_values[TimelineSubmit::MAX_SEMAPHORES * 2];
+    uint32_t wait_count = 0;
+
+    for (uint32_t i = 0; i < submit.m_binary_wait_count; i++) {
+        waits[wait_count] = submit.m_binary_waits[i];
+        stages[wait_count] = submit.m_binary_stages[i];
+        wait_values[wait_count++] = 0;
+    }
+    for (uint32_t i = 0; i < submit.m_wait_count; i++) {
+        const auto& wait = submit.m_waits[i];
+        if (wait.timeline->is_complete(device, wait.value)) continue;
+        if (m_use_semaphore && wait.timeline->m_use_semaphore) {
+            waits[wait_count] = wait.timeline->m_semaphore;
+            stages[wait_count] = wait.stage;
+            wait_values[wait_count++] = wait.value;
+        } else {
+            // No GPU-side primitive to wait on; serialize on the CPU.
+            wait.timeline->wait(device, wait.value);
+        }
+    }
+
+    VkSemaphore signals[TimelineSubmit::MAX_SEMAPHORES + 1];
+    uint64_t signal_values[TimelineSubmit::MAX_SEMAPHORES + 1];
+    uint32_t signal_count = 0;
+    for (uint32_t i = 0; i < submit.m_binary_signal_count; i++) {
+        signals[signal_count] = submit.m_binary_signals[i];
+        signal_values[signal_count++] = 0;
+    }
+    if (m_use_semaphore) {
+        signals[signal_count] = m_semaphore;
+        signal_values[signal_count++] = value;
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = wait_count;
+    timelineInfo.pWaitSemaphoreValues = wait_values;
+    timelineInfo.signalSemaphoreValueCount = signal_count;
+    timelineInfo.pSignalSemaphoreValues = signal_values;
+
+    VkSubmitInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.pNext = m_use_semaphore ? &timelineInfo : nullptr;
+    info.waitSemaphoreCount = wait_count;
+    info.pWaitSemaphores = waits;
+    info.pWaitDstStageMask = stages;
+    info.commandBufferCount = submit.command_buffer ? 1 : 0;
+    info.pCommandBuffers = &submit.command_buffer;
+    info.signalSemaphoreCount = signal_count;
+    info.pSignalSemaphores = signals;
+
+    VkFence fence = m_use_semaphore ? VK_NULL_HANDLE : acquire_fence(device);
+    if (vkQueueSubmit(m_queue, 1, &info, fence) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit to queue!");
+
+    if (fence) m_pending.push_back({value, fence});
+    m_submitted = value;
+    return value;
+}
+
+uint64_t QueueTimeline::completed(VkDevice device) {
+    if (m_use_semaphore) {
+        vkGetSemaphoreCounterValue(device, m_semaphore, &m_completed);
+        return m_completed;
+    }
+
+    // Fences on one queue signal in submission order.
+    while (!m_pending.empty() && vkGetFenceStatus(device, m_pending.front().second) == VK_SUCCESS) {
+        auto [value, fence] = m_pending.front();
+        m_pending.pop_front();
+        vkResetFences(device, 1, &fence);
+        m_free_fences.push_back(fence);
+        m_completed = value;
+    }
+    return m_completed;
+}
+
+void QueueTimeline::wait(VkDevice device, uint64_t value) {
+    if (value > m_submitted) throw std::runtime_error("waiting on a timeline value that was never submitted!");
+    if (is_complete(device, value)) return;
+
+    if (m_use_semaphore) {
+        VkSemaphoreWaitInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        info.semaphoreCount = 1;
+        info.pSemaphores = &m_semaphore;
+        info.pValues = &value;
+        vkWaitSemaphores(device, &info, UINT64_MAX);
+        m_completed = std::max(m_completed, value);
+        return;
+    }
+
+    for (auto& [pending_value, fence] : m_pending) {
+        if (pending_value >= value) {
+            vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+            break;
+        }
+    }
+    completed(device);
+}
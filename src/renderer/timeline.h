@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+struct QueueTimeline;
+
+// One vkQueueSubmit against a QueueTimeline. The timeline's next value is
+// signaled automatically; waits on other queues' timelines express
+// cross-queue dependencies (transfer -> graphics, compute -> graphics).
+// Binary semaphores are still needed for the swapchain.
+struct TimelineSubmit {
+    static const uint32_t MAX_SEMAPHORES = 8;
+
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+
+    void wait(QueueTimeline& timeline, uint64_t value, VkPipelineStageFlags stage);
+    void wait_binary(VkSemaphore semaphore, VkPipelineStageFlags stage);
+    void signal_binary(VkSemaphore semaphore);
+
+    private:
+    friend struct QueueTimeline;
+    struct TimelineWait {
+        QueueTimeline* timeline;
+        uint64_t value;
+        VkPipelineStageFlags stage;
+    };
+
+    TimelineWait m_waits[MAX_SEMAPHORES];
+    uint32_t m_wait_count = 0;
+    VkSemaphore m_binary_waits[MAX_SEMAPHORES];
+    VkPipelineStageFlags m_binary_stages[MAX_SEMAPHORES];
+    uint32_t m_binary_wait_count = 0;
+    VkSemaphore m_binary_signals[MAX_SEMAPHORES];
+    uint32_t m_binary_signal_count = 0;
+};
+
+// A monotonically increasing counter per queue: every submit signals the
+// next value, so "has frame N finished" is one integer compare and the CPU
+// can wait for exactly the work it needs instead of idling the device.
+//
+// Backed by a Vulkan 1.2 timeline semaphore when the device has one;
+// otherwise each submit gets a pooled fence and waits on other timelines are
+// resolved on the CPU before submitting. Not thread-safe: submit and query
+// from the render thread.
+struct QueueTimeline {
+    void init(VkDevice device, VkQueue queue, bool use_semaphore);
+    void deinit(VkDevice device);
+
+    uint64_t submit(VkDevice device, const TimelineSubmit& submit);
+
+    // Last value handed out by submit(); 0 before the first submit.
+    uint64_t submitted() const { return m_submitted; }
+    // Highest value the GPU has finished. Non-blocking.
+    uint64_t completed(VkDevice device);
+    bool is_complete(VkDevice device, uint64_t value) { return value <= m_completed || value <= completed(device); }
+    // Blocks the calling thread until `value` has been reached.
+    void wait(VkDevice device, uint64_t value);
+
+    VkQueue queue() const { return m_queue; }
+    bool uses_semaphore() const { return m_use_semaphore; }
+
+    private:
+    friend struct TimelineSubmit;
+
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    bool m_use_semaphore = false;
+    uint64_t m_submitted = 0;
+    uint64_t m_completed = 0;
+
+    // Fence fallback: one fence per submitted value, oldest first.
+    std::deque<std::pair<uint64_t, VkFence>> m_pending;
+    std::vector<VkFence> m_free_fences;
+
+    VkFence acquire_fence(VkDevice device);
+};
@@ -0,0 +1,406 @@
+#include "bc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint32_t codec_block_bytes(BlockCodec codec) {
+    switch (codec) {
+        case BlockCodec::RGBA8: return 4;
+        case BlockCodec::BC1: return 8;
+        case BlockCodec::BC3:
+        case BlockCodec::BC5:
+        case BlockCodec::BC7: return 16;
+    }
+    return 0;
+}
+
+size_t codec_image_size(BlockCodec codec, uint32_t width, uint32_t height) {
+    if (codec == BlockCodec::RGBA8) return size_t(width) * height * 4;
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * codec_block_bytes(codec);
+}
+
+// ---------------- shared helpers ----------------
+namespace {
+    // Principal axis of `count` points of `dims` channels by power
+    // iteration on their covariance; endpoints are then the extreme points
+    // along it, which fits the gradients most blocks are.
+    template <int Dims>
+    void principal_extremes(const float points[16][Dims], float low[Dims], float high[Dims]) {
+        float mean[Dims] = {};
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < Dims; c++) mean[c] += points[i][c] / 16.0f;
+
+        float cov[Dims][Dims] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < Dims; a++)
+                for (int b = 0; b < Dims; b++)
+                    cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+        float axis[Dims];
+        for (int c = 0; c < Dims; c++) axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float next[Dims] = {};
+            for (int a = 0; a < Dims; a++)
+                for (int b = 0; b < Dims; b++) next[a] += cov[a][b] * axis[b];
+            float length = 0.0f;
+            for (int c = 0; c < Dims; c++) length += next[c] * next[c];
+            if (length < 1e-12f) break;
+            length = std::sqrt(length);
+            for (int c = 0; c < Dims; c++) axis[c] = next[c] / length;
+        }
+
+        float lowT = 1e30f, highT = -1e30f;
+        int lowI = 0, highI = 0;
+        for (int i = 0; i < 16; i++) {
+            float t = 0.0f;
+            for (int c = 0; c < Dims; c++) t += (points[i][c] - mean[c]) * axis[c];
+            if (t < lowT) { lowT = t; lowI = i; }
+            if (t > highT) { highT = t; highI = i; }
+        }
+        for (int c = 0; c < Dims; c++) {
+            low[c] = points[lowI][c];
+            high[c] = points[highI][c];
+        }
+    }
+
+    uint16_t pack565(const float c[3]) {
+        auto q = [](float v, int max) { return static_cast<uint16_t>(std::clamp(int(v * max / 255.0f + 0.5f), 0, max)); };
+        return static_cast<uint16_t>(q(c[0], 31) << 11 | q(c[1], 63) << 5 | q(c[2], 31));
+    }
+
+    void unpack565(uint16_t v, int c[3]) {
+        int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+    }
+
+    void bc1_palette(uint16_t c0, uint16_t c1, bool four_colors, int palette[4][4]) {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+        for (int c = 0; c < 3; c++) {
+            if (four_colors) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            } else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = four_colors ? 255 : 0;
+    }
+
+    void encode_bc1_color(const uint8_t rgba[64], uint8_t out[8]) {
+        float points[16][3];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++) points[i][c] = rgba[i * 4 + c];
+        float low[3], high[3];
+        principal_extremes<3>(points, low, high);
+
+        uint16_t c0 = pack565(high);
+        uint16_t c1 = pack565(low);
+        if (c0 < c1) std::swap(c0, c1);
+
+        // Equal endpoints select the 3-color mode, where index 0 is still c0.
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            int palette[4][4];
+            bc1_palette(c0, c1, true, palette);
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 4; p++) {
+                    int error = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int d = rgba[i * 4 + c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError) { bestError = error; best = p; }
+                }
+                indices |= uint32_t(best) << (2 * i);
+            }
+        }
+        out[0] = uint8_t(c0);
+        out[1] = uint8_t(c0 >> 8);
+        out[2] = uint8_t(c1);
+        out[3] = uint8_t(c1 >> 8);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    void decode_bc1_color(const uint8_t in[8], bool force_four, uint8_t rgba[64]) {
+        uint16_t c0 = uint16_t(in[0] | in[1] << 8);
+        uint16_t c1 = uint16_t(in[2] | in[3] << 8);
+        int palette[4][4];
+        bc1_palette(c0, c1, force_four || c0 > c1, palette);
+        uint32_t indices;
+        std::memcpy(&indices, in + 4, 4);
+        for (int i = 0; i < 16; i++) {
+            const int* p = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 4; c++) rgba[i * 4 + c] = uint8_t(p[c]);
+        }
+    }
+
+    void bc4_palette(int a0, int a1, int palette[8]) {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        } else {
+            for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // One channel of a block, `channel` of each RGBA pixel.
+    void encode_bc4(const uint8_t rgba[64], int channel, uint8_t out[8]) {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; i++) {
+            low = std::min(low, int(rgba[i * 4 + channel]));
+            high = std::max(high, int(rgba[i * 4 + channel]));
+        }
+        int palette[8];
+        bc4_palette(high, low, palette);
+
+        uint64_t indices = 0;
+        if (high != low) {
+            for (int i = 0; i < 16; i++) {
+                int v = rgba[i * 4 + channel];
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 8; p++) {
+                    int error = std::abs(v - palette[p]);
+                    if (error < bestError) { bestError = error; best = p; }
+                }
+                indices |= uint64_t(best) << (3 * i);
+            }
+        }
+        out[0] = uint8_t(high);
+        out[1] = uint8_t(low);
+        for (int b = 0; b < 6; b++) out[2 + b] = uint8_t(indices >> (8 * b));
+    }
+
+    void decode_bc4(const uint8_t in[8], int channel, uint8_t rgba[64]) {
+        int palette[8];
+        bc4_palette(in[0], in[1], palette);
+        uint64_t indices = 0;
+        for (int b = 0; b < 6; b++) indices |= uint64_t(in[2 + b]) << (8 * b);
+        for (int i = 0; i < 16; i++) rgba[i * 4 + channel] = uint8_t(palette[(indices >> (3 * i)) & 7]);
+    }
+
+    // LSB-first bit stream over a 16-byte block.
+    struct BitWriter {
+        uint8_t* out;
+        int bit = 0;
+
+        void put(uint32_t value, int count) {
+            for (int i = 0; i < count; i++, bit++)
+                if (value & (1u << i)) out[bit >> 3] |= uint8_t(1u << (bit & 7));
+        }
+    };
+
+    struct BitReader {
+        const uint8_t* in;
+        int bit = 0;
+
+        uint32_t get(int count) {
+            uint32_t value = 0;
+            for (int i = 0; i < count; i++, bit++)
+                value |= uint32_t((in[bit >> 3] >> (bit & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    const int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    int bc7_interpolate(int e0, int e1, int index) {
+        return ((64 - BC7_WEIGHTS4[index]) * e0 + BC7_WEIGHTS4[index] * e1 + 32) >> 6;
+    }
+
+    // Best 7-bit endpoint plus shared p-bit for an RGBA color.
+    void bc7_quantize(const float color[4], int endpoint[4], int& pbit) {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 2; p++) {
+            int q[4], error = 0;
+            for (int c = 0; c < 4; c++) {
+                q[c] = std::clamp(int((color[c] - p) / 2.0f + 0.5f), 0, 127);
+                int d = ((q[c] << 1) | p) - int(color[c] + 0.5f);
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pbit = p;
+                std::copy(q, q + 4, endpoint);
+            }
+        }
+    }
+}
+
+// ---------------- blocks ----------------
+void encode_bc1_block(const uint8_t rgba[64], uint8_t out[8]) {
+    encode_bc1_color(rgba, out);
+}
+
+void encode_bc3_block(const uint8_t rgba[64], uint8_t out[16]) {
+    encode_bc4(rgba, 3, out);
+    encode_bc1_color(rgba, out + 8);
+}
+
+void encode_bc5_block(const uint8_t rgba[64], uint8_t out[16]) {
+    encode_bc4(rgba, 0, out);
+    encode_bc4(rgba, 1, out + 8);
+}
+
+void encode_bc7_block(const uint8_t rgba[64], uint8_t out[16]) {
+    float points[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) points[i][c] = rgba[i * 4 + c];
+    float low[4], high[4];
+    principal_extremes<4>(points, low, high);
+
+    int e[2][4], p[2];
+    bc7_quantize(low, e[0], p[0]);
+    bc7_quantize(high, e[1], p[1]);
+
+    int full[2][4];
+    for (int s = 0; s < 2; s++)
+        for (int c = 0; c < 4; c++) full[s][c] = (e[s][c] << 1) | p[s];
+
+    int indices[16];
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int k = 0; k < 16; k++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = rgba[i * 4 + c] - bc7_interpolate(full[0][c], full[1][c], k);
+                error += d * d;
+            }
+            if (error < bestError) { bestError = error; best = k; }
+        }
+        indices[i] = best;
+    }
+
+    // The anchor (first) index is stored without its top bit.
+    if (indices[0] & 8) {
+        std::swap(e[0], e[1]);
+        std::swap(p[0], p[1]);
+        for (int& index : indices) index = 15 - index;
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.put(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.put(e[0][c], 7);
+        writer.put(e[1][c], 7);
+    }
+    writer.put(p[0], 1);
+    writer.put(p[1], 1);
+    writer.put(indices[0], 3);
+    for (int i = 1; i < 16; i++) writer.put(indices[i], 4);
+}
+
+void decode_bc1_block(const uint8_t in[8], uint8_t rgba[64]) {
+    decode_bc1_color(in, false, rgba);
+}
+
+void decode_bc3_block(const uint8_t in[16], uint8_t rgba[64]) {
+    decode_bc1_color(in + 8, true, rgba);
+    decode_bc4(in, 3, rgba);
+}
+
+void decode_bc5_block(const uint8_t in[16], uint8_t rgba[64]) {
+    decode_bc4(in, 0, rgba);
+    decode_bc4(in + 8, 1, rgba);
+    for (int i = 0; i < 16; i++) {
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+void decode_bc7_block(const uint8_t in[16], uint8_t rgba[64]) {
+    if ((in[0] & 0x7F) != 0x40) {
+        for (int i = 0; i < 16; i++) {
+            rgba[i * 4 + 0] = 255;
+            rgba[i * 4 + 1] = 0;
+            rgba[i * 4 + 2] = 255;
+            rgba[i * 4 + 3] = 255;
+        }
+        return;
+    }
+
+    BitReader reader{in, 7};
+    int e[2][4];
+    for (int c = 0; c < 4; c++) {
+        e[0][c] = int(reader.get(7)) << 1;
+        e[1][c] = int(reader.get(7)) << 1;
+    }
+    int p0 = int(reader.get(1)), p1 = int(reader.get(1));
+    for (int c = 0; c < 4; c++) {
+        e[0][c] |= p0;
+        e[1][c] |= p1;
+    }
+    for (int i = 0; i < 16; i++) {
+        int index = int(reader.get(i == 0 ? 3 : 4));
+        for (int c = 0; c < 4; c++) rgba[i * 4 + c] = uint8_t(bc7_interpolate(e[0][c], e[1][c], index));
+    }
+}
+
+// ---------------- images ----------------
+std::vector<uint8_t> encode_image(BlockCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height) {
+    if (codec == BlockCodec::RGBA8) return std::vector<uint8_t>(rgba, rgba + size_t(width) * height * 4);
+
+    std::vector<uint8_t> out(codec_image_size(codec, width, height));
+    uint32_t blockBytes = codec_block_bytes(codec);
+    uint8_t* dst = out.data();
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t sy = std::min(by + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t sx = std::min(bx + x, width - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+                }
+            }
+            switch (codec) {
+                case BlockCodec::BC1: encode_bc1_block(block, dst); break;
+                case BlockCodec::BC3: encode_bc3_block(block, dst); break;
+                case BlockCodec::BC5: encode_bc5_block(block, dst); break;
+                case BlockCodec::BC7: encode_bc7_block(block, dst); break;
+                case BlockCodec::RGBA8: break;
+            }
+            dst += blockBytes;
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> decode_image(BlockCodec codec, const uint8_t* data, uint32_t width, uint32_t height) {
+    if (codec == BlockCodec::RGBA8) return std::vector<uint8_t>(data, data + size_t(width) * height * 4);
+
+    std::vector<uint8_t> out(size_t(width) * height * 4);
+    uint32_t blockBytes = codec_block_bytes(codec);
+    const uint8_t* src = data;
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            switch (codec) {
+                case BlockCodec::BC1: decode_bc1_block(src, block); break;
+                case BlockCodec::BC3: decode_bc3_block(src, block); break;
+                case BlockCodec::BC5: decode_bc5_block(src, block); break;
+                case BlockCodec::BC7: decode_bc7_block(src, block); break;
+                case BlockCodec::RGBA8: break;
+            }
+            src += blockBytes;
+
+            uint32_t columns = std::min(4u, width - bx);
+            for (uint32_t y = 0; y < 4 && by + y < height; y++)
+                std::memcpy(out.data() + (size_t(by + y) * width + bx) * 4, block + y * 16, columns * 4);
+        }
+    }
+    return out;
+}
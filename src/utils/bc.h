@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Block-compressed texture codecs. Every format stores 4x4 pixel blocks;
+// BC1 in 8 bytes, the others in 16. Images are tightly packed RGBA8, top
+// row first; sizes that are not a multiple of 4 repeat their edge pixels
+// into the padding.
+//
+//   BC1  RGB, 4 bpp        opaque color
+//   BC3  RGBA, 8 bpp       color with alpha (BC1 color + BC4 alpha)
+//   BC5  RG, 8 bpp         normal maps (x and y; z is rebuilt in the shader)
+//   BC7  RGBA, 8 bpp       high quality color
+//
+// The encoders are meant for the offline baker, the decoders for devices
+// without BC sampling. The BC7 encoder only emits mode 6 (one subset,
+// 7-bit endpoints with p-bits, 4-bit indices), and the decoder only reads
+// that mode: anything else decodes as opaque magenta.
+enum class BlockCodec : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1,
+    BC3 = 2,
+    BC5 = 3,
+    BC7 = 4,
+};
+
+// Bytes per 4x4 block, or per pixel for RGBA8.
+uint32_t codec_block_bytes(BlockCodec codec);
+// Size of one image (one mip level) in `codec`.
+size_t codec_image_size(BlockCodec codec, uint32_t width, uint32_t height);
+
+void encode_bc1_block(const uint8_t rgba[64], uint8_t out[8]);
+void encode_bc3_block(const uint8_t rgba[64], uint8_t out[16]);
+void encode_bc5_block(const uint8_t rgba[64], uint8_t out[16]);
+void encode_bc7_block(const uint8_t rgba[64], uint8_t out[16]);
+
+void decode_bc1_block(const uint8_t in[8], uint8_t rgba[64]);
+void decode_bc3_block(const uint8_t in[16], uint8_t rgba[64]);
+void decode_bc5_block(const uint8_t in[16], uint8_t rgba[64]);
+void decode_bc7_block(const uint8_t in[16], uint8_t rgba[64]);
+
+std::vector<uint8_t> encode_image(BlockCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height);
+// Back to RGBA8. BC5 decodes to (x, y, 0, 255).
+std::vector<uint8_t> decode_image(BlockCodec codec, const uint8_t* data, uint32_t width, uint32_t height);
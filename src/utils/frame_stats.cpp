@@ -0,0 +1,24 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+FrameStats compute_frame_stats(std::vector<double> frame_ms) {
+    FrameStats stats;
+    if (frame_ms.empty()) return stats;
+
+    std::sort(frame_ms.begin(), frame_ms.end());
+    stats.frames = static_cast<uint32_t>(frame_ms.size());
+    stats.mean_ms = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0) / frame_ms.size();
+    stats.min_ms = frame_ms.front();
+    stats.max_ms = frame_ms.back();
+    stats.p50_ms = percentile(frame_ms, 50.0);
+    stats.p99_ms = percentile(frame_ms, 99.0);
+    return stats;
+}
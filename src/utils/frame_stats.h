@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct FrameStats {
+    uint32_t frames = 0;
+    double mean_ms = 0.0;
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+};
+
+// Summarizes a list of per-frame times (milliseconds). Percentiles use the
+// nearest-rank method.
+FrameStats compute_frame_stats(std::vector<double> frame_ms);
@@ -0,0 +1,98 @@
+#include "image_write.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+static void write_chunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    put_u32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put_u32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+bool write_png(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels) {
+    if (channels != 3 && channels != 4) return false;
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    put_u32(header, width);
+    put_u32(header, height);
+    header.push_back(8);                      // bit depth
+    header.push_back(channels == 4 ? 6 : 2);  // RGBA / RGB
+    header.push_back(0);                      // deflate
+    header.push_back(0);                      // adaptive filtering
+    header.push_back(0);                      // no interlace
+    write_chunk(file, "IHDR", header);
+
+    // Every scanline is prefixed with filter type 0 (none).
+    size_t row = size_t(width) * channels;
+    std::vector<uint8_t> raw;
+    raw.reserve((row + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * row, pixels + (y + 1) * row);
+    }
+
+    // zlib stream made of stored blocks (at most 65535 bytes each).
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (size_t offset = 0; offset < raw.size() || offset == 0;) {
+        size_t size = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(uint8_t(size));
+        zlib.push_back(uint8_t(size >> 8));
+        zlib.push_back(uint8_t(~size));
+        zlib.push_back(uint8_t(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; i++) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        offset += size;
+        if (last) break;
+    }
+    put_u32(zlib, (b << 16) | a);
+    write_chunk(file, "IDAT", zlib);
+    write_chunk(file, "IEND", {});
+    return file.good();
+}
+
+bool write_ppm(const std::string& path, const uint8_t* rgb, uint32_t width, uint32_t height) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(rgb), size_t(width) * height * 3);
+    return file.good();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Writers for tightly packed 8-bit pixels, top row first. No compression
+// library is linked, so PNGs use stored (uncompressed) deflate blocks: larger
+// files, but valid everywhere and cheap to produce.
+bool write_png(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels);
+bool write_ppm(const std::string& path, const uint8_t* rgb, uint32_t width, uint32_t height);
@@ -0,0 +1,118 @@
+#include "texture_asset.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t codec;
+        uint32_t srgb;
+        uint32_t width;
+        uint32_t height;
+        uint32_t level_count;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Header) == 32);
+
+    struct LevelEntry {
+        uint64_t offset;
+        uint64_t size;
+    };
+    static_assert(sizeof(LevelEntry) == 16);
+}
+
+void write_texture_asset(const std::string& path, const TextureAsset& asset) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open texture asset for writing!");
+
+    Header header{TextureAsset::MAGIC,
+                  TextureAsset::VERSION,
+                  static_cast<uint32_t>(asset.codec),
+                  asset.srgb ? 1u : 0u,
+                  asset.width,
+                  asset.height,
+                  static_cast<uint32_t>(asset.levels.size()),
+                  0};
+
+    std::vector<LevelEntry> table(asset.levels.size());
+    uint64_t offset = sizeof(Header) + sizeof(LevelEntry) * table.size();
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = {offset, asset.levels[i].size()};
+        offset += asset.levels[i].size();
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), sizeof(LevelEntry) * table.size());
+    for (const std::vector<uint8_t>& level : asset.levels)
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    if (!file) throw std::runtime_error("failed to write texture asset!");
+}
+
+TextureAssetInfo read_texture_asset_info(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) throw std::runtime_error("failed to open texture asset!");
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != TextureAsset::MAGIC)
+        throw std::runtime_error("not a texture asset!");
+    if (header.version != TextureAsset::VERSION) throw std::runtime_error("unsupported texture asset version!");
+    if (header.codec > static_cast<uint32_t>(BlockCodec::BC7) || header.level_count == 0 || header.level_count > 32)
+        throw std::runtime_error("malformed texture asset!");
+
+    TextureAssetInfo info;
+    info.codec = static_cast<BlockCodec>(header.codec);
+    info.srgb = header.srgb != 0;
+    info.width = header.width;
+    info.height = header.height;
+
+    std::vector<LevelEntry> table(header.level_count);
+    if (!file.read(reinterpret_cast<char*>(table.data()), sizeof(LevelEntry) * table.size()))
+        throw std::runtime_error("malformed texture asset!");
+
+    for (size_t i = 0; i < table.size(); i++) {
+        uint32_t w = std::max(info.width >> i, 1u);
+        uint32_t h = std::max(info.height >> i, 1u);
+        if (table[i].size != codec_image_size(info.codec, w, h) || table[i].offset + table[i].size > fileSize)
+            throw std::runtime_error("malformed texture asset!");
+        info.level_offsets.push_back(table[i].offset);
+        info.level_sizes.push_back(table[i].size);
+    }
+    return info;
+}
+
+std::vector<uint8_t> read_texture_asset_level(const std::string& path, const TextureAssetInfo& info, uint32_t level) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open texture asset!");
+
+    std::vector<uint8_t> data(info.level_sizes.at(level));
+    file.seekg(static_cast<std::streamoff>(info.level_offsets[level]));
+    if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+        throw std::runtime_error("failed to read texture asset!");
+    return data;
+}
+
+TextureAsset read_texture_asset(const std::string& path) {
+    TextureAssetInfo info = read_texture_asset_info(path);
+
+    TextureAsset asset;
+    asset.codec = info.codec;
+    asset.srgb = info.srgb;
+    asset.width = info.width;
+    asset.height = info.height;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open texture asset!");
+    asset.levels.resize(info.level_count());
+    for (uint32_t i = 0; i < info.level_count(); i++) {
+        asset.levels[i].resize(info.level_sizes[i]);
+        file.seekg(static_cast<std::streamoff>(info.level_offsets[i]));
+        file.read(reinterpret_cast<char*>(asset.levels[i].data()), info.level_sizes[i]);
+    }
+    if (!file) throw std::runtime_error("failed to read texture asset!");
+    return asset;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "bc.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// .rtex: a baked texture with every mip level precomputed and stored in its
+// final GPU layout, so loading is a read and a copy.
+//
+//   header   magic "RTEX", version, codec, srgb, width, height, level count
+//   table    per level: byte offset from the start of the file, byte size
+//   data     levels from largest to smallest
+//
+// All fields are little-endian uint32 (offsets and sizes uint64).
+struct TextureAsset {
+    static constexpr uint32_t MAGIC = 0x58455452;  // "RTEX"
+    static constexpr uint32_t VERSION = 1;
+
+    BlockCodec codec = BlockCodec::RGBA8;
+    bool srgb = true;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+// Header and level table without the pixel data, so levels can be read
+// one at a time later (texture streaming).
+struct TextureAssetInfo {
+    BlockCodec codec = BlockCodec::RGBA8;
+    bool srgb = true;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint64_t> level_offsets;
+    std::vector<uint64_t> level_sizes;
+
+    uint32_t level_count() const { return static_cast<uint32_t>(level_offsets.size()); }
+};
+
+// All of these throw std::runtime_error on I/O errors or a malformed file.
+void write_texture_asset(const std::string& path, const TextureAsset& asset);
+TextureAsset read_texture_asset(const std::string& path);
+TextureAssetInfo read_texture_asset_info(const std::string& path);
+std::vector<uint8_t> read_texture_asset_level(const std::string& path, const TextureAssetInfo& info, uint32_t level);
@@ -1,5 +1,6 @@
 #include "window.h"
 #include "const.h"
+#include "renderer/host_allocator.h"
 
 #include <stdexcept>
 
@@ -10,7 +11,7 @@ void Window::init_window() {
 }
 
 void Window::create_surface(VkInstance instance, VkSurfaceKHR *surface) {
-    if (glfwCreateWindowSurface(instance, inner, nullptr, surface) != VK_SUCCESS)
+    if (glfwCreateWindowSurface(instance, inner, host_allocator(), surface) != VK_SUCCESS)
         throw std::runtime_error("failed to create window surface!");
 }
 
@@ -0,0 +1,184 @@
+// Offline texture baker: reads a PPM (P6) or PAM (P7, RGB or RGB_ALPHA)
+// image, builds the full mip chain on the CPU and writes an .rtex with every
+// level block-compressed for its role. Build with `make texture_baker`, run
+// as `./texture_baker [--role color|color_alpha|normal|hq] [--linear] in out.rtex`.
+//
+//   color        BC1   opaque albedo and the like
+//   color_alpha  BC3   albedo with alpha
+//   normal       BC5   tangent-space normals, always linear
+//   hq           BC7   color where BC1 banding shows
+#include "../src/utils/bc.h"
+#include "../src/utils/texture_asset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+static std::string next_token(std::istream& in) {
+    std::string token;
+    while (in >> token) {
+        if (token[0] != '#') return token;
+        std::string comment;
+        std::getline(in, comment);
+    }
+    return token;
+}
+
+static bool read_image(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    std::string magic = next_token(file);
+    uint32_t channels = 0;
+    if (magic == "P6") {
+        image.width = std::stoul(next_token(file));
+        image.height = std::stoul(next_token(file));
+        if (std::stoul(next_token(file)) != 255) return false;
+        channels = 3;
+    } else if (magic == "P7") {
+        uint32_t maxval = 0;
+        for (std::string key = next_token(file); key != "ENDHDR" && file; key = next_token(file)) {
+            if (key == "WIDTH") image.width = std::stoul(next_token(file));
+            else if (key == "HEIGHT") image.height = std::stoul(next_token(file));
+            else if (key == "DEPTH") channels = std::stoul(next_token(file));
+            else if (key == "MAXVAL") maxval = std::stoul(next_token(file));
+            else if (key == "TUPLTYPE") next_token(file);
+        }
+        if (maxval != 255 || (channels != 3 && channels != 4)) return false;
+    } else {
+        return false;
+    }
+    if (image.width == 0 || image.height == 0) return false;
+    file.get();  // the single whitespace byte before the raster
+
+    std::vector<uint8_t> raw(size_t(image.width) * image.height * channels);
+    if (!file.read(reinterpret_cast<char*>(raw.data()), raw.size())) return false;
+
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+    for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+        for (uint32_t c = 0; c < 3; c++) image.rgba[i * 4 + c] = raw[i * channels + c];
+        image.rgba[i * 4 + 3] = channels == 4 ? raw[i * channels + 3] : 255;
+    }
+    return true;
+}
+
+static float to_linear(uint8_t v) {
+    float c = v / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t to_srgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// 2x2 box filter. Color is averaged in linear space when sRGB, normals are
+// averaged as vectors and renormalized so lower mips do not shorten them.
+static Image downsample(const Image& src, bool srgb, bool normal) {
+    Image dst;
+    dst.width = std::max(src.width / 2, 1u);
+    dst.height = std::max(src.height / 2, 1u);
+    dst.rgba.resize(size_t(dst.width) * dst.height * 4);
+
+    for (uint32_t y = 0; y < dst.height; y++) {
+        for (uint32_t x = 0; x < dst.width; x++) {
+            float sum[4] = {};
+            for (uint32_t dy = 0; dy < 2; dy++) {
+                for (uint32_t dx = 0; dx < 2; dx++) {
+                    uint32_t sx = std::min(x * 2 + dx, src.width - 1);
+                    uint32_t sy = std::min(y * 2 + dy, src.height - 1);
+                    const uint8_t* p = &src.rgba[(size_t(sy) * src.width + sx) * 4];
+                    for (int c = 0; c < 4; c++) {
+                        if (normal && c < 3) sum[c] += p[c] / 127.5f - 1.0f;
+                        else sum[c] += (srgb && c < 3) ? to_linear(p[c]) : p[c] / 255.0f;
+                    }
+                }
+            }
+            uint8_t* out = &dst.rgba[(size_t(y) * dst.width + x) * 4];
+            if (normal) {
+                float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                if (length < 1e-6f) length = 1.0f;
+                for (int c = 0; c < 3; c++)
+                    out[c] = static_cast<uint8_t>(std::clamp((sum[c] / length + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f));
+            } else {
+                for (int c = 0; c < 3; c++)
+                    out[c] = srgb ? to_srgb(sum[c] / 4.0f)
+                                  : static_cast<uint8_t>(std::clamp(sum[c] / 4.0f * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+            out[3] = static_cast<uint8_t>(std::clamp(sum[3] / 4.0f * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+    return dst;
+}
+
+int main(int argc, char** argv) {
+    std::string role = "color";
+    bool linear = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--role") && i + 1 < argc) {
+            role = argv[++i];
+        } else if (!std::strcmp(argv[i], "--linear")) {
+            linear = true;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    BlockCodec codec = BlockCodec::BC1;
+    if (role == "color") codec = BlockCodec::BC1;
+    else if (role == "color_alpha") codec = BlockCodec::BC3;
+    else if (role == "normal") codec = BlockCodec::BC5;
+    else if (role == "hq") codec = BlockCodec::BC7;
+    else paths.clear();
+
+    if (paths.size() != 2) {
+        std::fprintf(stderr, "usage: texture_baker [--role color|color_alpha|normal|hq] [--linear] in.ppm out.rtex\n");
+        return 1;
+    }
+
+    Image image;
+    if (!read_image(paths[0], image)) {
+        std::fprintf(stderr, "failed to read %s\n", paths[0].c_str());
+        return 1;
+    }
+
+    bool normal = codec == BlockCodec::BC5;
+    TextureAsset asset;
+    asset.codec = codec;
+    asset.srgb = !linear && !normal;
+    asset.width = image.width;
+    asset.height = image.height;
+
+    size_t rawBytes = 0;
+    for (;;) {
+        asset.levels.push_back(encode_image(codec, image.rgba.data(), image.width, image.height));
+        rawBytes += image.rgba.size();
+        if (image.width == 1 && image.height == 1) break;
+        image = downsample(image, asset.srgb, normal);
+    }
+
+    try {
+        write_texture_asset(paths[1], asset);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    size_t bakedBytes = 0;
+    for (const auto& level : asset.levels) bakedBytes += level.size();
+    std::fprintf(stderr, "%s: %ux%u, %zu levels, %zu -> %zu bytes (%.1fx)\n", paths[1].c_str(), asset.width,
+                 asset.height, asset.levels.size(), rawBytes, bakedBytes, double(rawBytes) / double(bakedBytes));
+    return 0;
+}